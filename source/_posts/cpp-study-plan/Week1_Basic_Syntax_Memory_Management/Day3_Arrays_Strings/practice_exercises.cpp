@@ -4,6 +4,13 @@
 #include <algorithm>
 #include <vector>
 #include <chrono>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <initializer_list>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
 using namespace std;
 
 // 练习1：数组基本操作
@@ -397,33 +404,149 @@ public:
 };
 
 // 练习5：二维数组操作
+// 非拥有的矩阵视图：首地址 + 行数、列数、行跨度，取子矩阵不需要拷贝
+template<typename T>
+class MatrixView {
+private:
+    T* data_;
+    int rows_;
+    int cols_;
+    int stride_;
+    
+public:
+    MatrixView(T* data, int rows, int cols, int stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+    
+    // 可写视图可以隐式转换为只读视图
+    template<typename U, typename = enable_if_t<is_same<const U, T>::value>>
+    MatrixView(const MatrixView<U>& other)
+        : data_(other.data()), rows_(other.rows()), cols_(other.cols()), stride_(other.stride()) {}
+    
+    T& operator()(int i, int j) const { return data_[i * stride_ + j]; }
+    T* data() const { return data_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int stride() const { return stride_; }
+    
+    MatrixView submatrix(int row0, int col0, int rows, int cols) const {
+        return MatrixView(data_ + row0 * stride_ + col0, rows, cols, stride_);
+    }
+};
+
+// 连续存储的矩阵：整块一次分配、64字节对齐，每行补齐到整条缓存行
+template<typename T>
+class Matrix {
+private:
+    static constexpr int ALIGNMENT = 64;
+    
+    struct AlignedDelete {
+        void operator()(T* p) const { ::operator delete[](p, align_val_t(ALIGNMENT)); }
+    };
+    
+    int rows_;
+    int cols_;
+    int stride_;
+    unique_ptr<T[], AlignedDelete> data_;
+    
+    static int paddedStride(int cols) {
+        int perLine = max(1, ALIGNMENT / static_cast<int>(sizeof(T)));
+        return (cols + perLine - 1) / perLine * perLine;
+    }
+    
+public:
+    Matrix(int rows, int cols, const T& value = T())
+        : rows_(rows), cols_(cols), stride_(paddedStride(cols)),
+          data_(static_cast<T*>(::operator new[](sizeof(T) * rows * stride_, align_val_t(ALIGNMENT)))) {
+        uninitialized_fill(data_.get(), data_.get() + rows_ * stride_, value);
+    }
+    
+    Matrix(Matrix&&) = default;
+    
+    // 不能默认生成：删除器只释放内存，旧元素要先手动析构
+    Matrix& operator=(Matrix&& other) noexcept {
+        if (this != &other) {
+            if (data_) {
+                destroy_n(data_.get(), rows_ * stride_);
+            }
+            data_ = move(other.data_);
+            rows_ = other.rows_;
+            cols_ = other.cols_;
+            stride_ = other.stride_;
+        }
+        return *this;
+    }
+    
+    ~Matrix() {
+        if (data_) {
+            destroy_n(data_.get(), rows_ * stride_);
+        }
+    }
+    
+    // 按行初始化：Matrix<int> m = {{1, 2}, {3, 4}}; 各行长度必须相同
+    Matrix(initializer_list<initializer_list<T>> values)
+        : Matrix(static_cast<int>(values.size()),
+                 values.size() ? static_cast<int>(values.begin()->size()) : 0) {
+        int i = 0;
+        for (const auto& rowValues : values) {
+            if (static_cast<int>(rowValues.size()) != cols_) {
+                throw invalid_argument("Matrix: all rows must have the same number of columns");
+            }
+            copy(rowValues.begin(), rowValues.end(), data_.get() + i++ * stride_);
+        }
+    }
+    
+    T& operator()(int i, int j) { return data_[i * stride_ + j]; }
+    const T& operator()(int i, int j) const { return data_[i * stride_ + j]; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int stride() const { return stride_; }
+    
+    operator MatrixView<T>() { return MatrixView<T>(data_.get(), rows_, cols_, stride_); }
+    operator MatrixView<const T>() const { return MatrixView<const T>(data_.get(), rows_, cols_, stride_); }
+    
+    MatrixView<T> submatrix(int row0, int col0, int rows, int cols) {
+        return MatrixView<T>(*this).submatrix(row0, col0, rows, cols);
+    }
+};
+
 class MatrixOperations {
 public:
     // 矩阵打印
-    static void printMatrix(int matrix[][4], int rows, int cols) {
+    static void printMatrix(MatrixView<const int> matrix) {
         cout << "矩阵内容:" << endl;
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                cout << matrix[i][j] << "\t";
+        for (int i = 0; i < matrix.rows(); i++) {
+            for (int j = 0; j < matrix.cols(); j++) {
+                cout << matrix(i, j) << "\t";
             }
             cout << endl;
         }
     }
     
-    // 矩阵转置
-    static void transposeMatrix(int matrix[][4], int rows, int cols) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = i + 1; j < cols; j++) {
-                swap(matrix[i][j], matrix[j][i]);
+    // 矩阵转置（任意形状，结果写入新矩阵）
+    static Matrix<int> transposeMatrix(MatrixView<const int> matrix) {
+        Matrix<int> result(matrix.cols(), matrix.rows());
+        for (int i = 0; i < matrix.rows(); i++) {
+            for (int j = 0; j < matrix.cols(); j++) {
+                result(j, i) = matrix(i, j);
+            }
+        }
+        return result;
+    }
+    
+    // 方阵原地转置
+    static void transposeInPlace(MatrixView<int> matrix) {
+        for (int i = 0; i < matrix.rows(); i++) {
+            for (int j = i + 1; j < matrix.cols(); j++) {
+                swap(matrix(i, j), matrix(j, i));
             }
         }
     }
     
     // 矩阵查找
-    static pair<int, int> findElement(int matrix[][4], int rows, int cols, int target) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                if (matrix[i][j] == target) {
+    static pair<int, int> findElement(MatrixView<const int> matrix, int target) {
+        for (int i = 0; i < matrix.rows(); i++) {
+            for (int j = 0; j < matrix.cols(); j++) {
+                if (matrix(i, j) == target) {
                     return {i, j};
                 }
             }
@@ -432,77 +555,158 @@ public:
     }
     
     // 矩阵行和列的和
-    static void calculateSums(int matrix[][4], int rows, int cols) {
+    static void calculateSums(MatrixView<const int> matrix) {
         cout << "行和:" << endl;
-        for (int i = 0; i < rows; i++) {
+        for (int i = 0; i < matrix.rows(); i++) {
             int rowSum = 0;
-            for (int j = 0; j < cols; j++) {
-                rowSum += matrix[i][j];
+            for (int j = 0; j < matrix.cols(); j++) {
+                rowSum += matrix(i, j);
             }
             cout << "第" << i + 1 << "行: " << rowSum << endl;
         }
         
-        cout << "列和:" << endl;
-        for (int j = 0; j < cols; j++) {
-            int colSum = 0;
-            for (int i = 0; i < rows; i++) {
-                colSum += matrix[i][j];
+        // 按行累加到每列的和里，保持顺序访问
+        vector<int> colSums(matrix.cols(), 0);
+        for (int i = 0; i < matrix.rows(); i++) {
+            for (int j = 0; j < matrix.cols(); j++) {
+                colSums[j] += matrix(i, j);
             }
-            cout << "第" << j + 1 << "列: " << colSum << endl;
+        }
+        cout << "列和:" << endl;
+        for (int j = 0; j < matrix.cols(); j++) {
+            cout << "第" << j + 1 << "列: " << colSums[j] << endl;
         }
     }
 };
 
 // 练习6：性能测试
-class PerformanceTest {
+// 固定种子的测试数据：同一种子每次生成完全相同的数组，不同运行之间的耗时可以直接对比
+enum class Distribution { Uniform, Sorted, ReverseSorted, FewUnique, Zipfian, OrganPipe };
+
+class WorkloadGenerator {
+private:
+    uint64_t s[4];  // xoshiro256**的状态，由SplitMix64展开种子得到
+    
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    
+    // [0, bound)内的整数，不用rand() % bound，也不依赖标准库分布的实现
+    int below(int bound) {
+        return static_cast<int>((next() >> 32) * static_cast<uint64_t>(bound) >> 32);
+    }
+    
 public:
-    static void testSortingPerformance() {
-        const int SIZE = 10000;
-        int* arr1 = new int[SIZE];
-        int* arr2 = new int[SIZE];
-        int* arr3 = new int[SIZE];
-        int* arr4 = new int[SIZE];
-        
-        // 生成随机数据
-        for (int i = 0; i < SIZE; i++) {
-            int val = rand() % 1000;
-            arr1[i] = arr2[i] = arr3[i] = arr4[i] = val;
+    explicit WorkloadGenerator(uint64_t seed) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            s[i] = z ^ (z >> 31);
+        }
+    }
+    
+    static const char* name(Distribution distribution) {
+        switch (distribution) {
+            case Distribution::Uniform: return "均匀随机";
+            case Distribution::Sorted: return "已排序";
+            case Distribution::ReverseSorted: return "逆序";
+            case Distribution::FewUnique: return "少量重复值";
+            case Distribution::Zipfian: return "Zipf分布";
+            case Distribution::OrganPipe: return "管风琴形";
+        }
+        return "未知";
+    }
+    
+    // 生成size个[0, range)内的整数
+    vector<int> generate(Distribution distribution, int size, int range) {
+        vector<int> data(size);
+        if (distribution == Distribution::FewUnique) {
+            int values[8];
+            for (int& v : values) v = below(range);
+            for (int& x : data) x = values[below(8)];
+        } else if (distribution == Distribution::Zipfian) {
+            // 值k出现的概率正比于1/(k+1)，小的值是"热点"
+            vector<double> cdf(range);
+            double total = 0.0;
+            for (int k = 0; k < range; k++) {
+                total += 1.0 / (k + 1);
+                cdf[k] = total;
+            }
+            for (int& x : data) {
+                double u = static_cast<double>(next() >> 11) * 0x1.0p-53 * total;
+                x = min(static_cast<int>(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), range - 1);
+            }
+        } else {
+            for (int& x : data) x = below(range);
         }
         
-        // 测试冒泡排序
+        if (distribution == Distribution::Sorted) {
+            sort(data.begin(), data.end());
+        } else if (distribution == Distribution::ReverseSorted) {
+            sort(data.begin(), data.end(), greater<int>());
+        } else if (distribution == Distribution::OrganPipe) {
+            // 先升后降：排序后偶数位放左半边，奇数位倒着放右半边
+            vector<int> sorted(data);
+            sort(sorted.begin(), sorted.end());
+            for (int i = 0; 2 * i < size; i++) data[i] = sorted[2 * i];
+            for (int k = 0; 2 * k + 1 < size; k++) data[size - 1 - k] = sorted[2 * k + 1];
+        }
+        return data;
+    }
+};
+
+class PerformanceTest {
+private:
+    // 计时前先把输入复制好，计时区域里只有排序本身
+    template<typename SortFunc>
+    static double timeSort(const vector<int>& input, SortFunc sortFunc, bool& ok) {
+        vector<int> work(input);
         auto start = chrono::high_resolution_clock::now();
-        SortingAlgorithms::bubbleSort(arr1, SIZE);
+        sortFunc(work.data(), static_cast<int>(work.size()));
         auto end = chrono::high_resolution_clock::now();
-        auto duration1 = chrono::duration_cast<chrono::milliseconds>(end - start);
-        
-        // 测试选择排序
-        start = chrono::high_resolution_clock::now();
-        SortingAlgorithms::selectionSort(arr2, SIZE);
-        end = chrono::high_resolution_clock::now();
-        auto duration2 = chrono::duration_cast<chrono::milliseconds>(end - start);
-        
-        // 测试插入排序
-        start = chrono::high_resolution_clock::now();
-        SortingAlgorithms::insertionSort(arr3, SIZE);
-        end = chrono::high_resolution_clock::now();
-        auto duration3 = chrono::duration_cast<chrono::milliseconds>(end - start);
-        
-        // 测试快速排序
-        start = chrono::high_resolution_clock::now();
-        SortingAlgorithms::quickSort(arr4, 0, SIZE - 1);
-        end = chrono::high_resolution_clock::now();
-        auto duration4 = chrono::duration_cast<chrono::milliseconds>(end - start);
-        
-        cout << "排序性能测试 (数组大小: " << SIZE << "):" << endl;
-        cout << "冒泡排序: " << duration1.count() << " ms" << endl;
-        cout << "选择排序: " << duration2.count() << " ms" << endl;
-        cout << "插入排序: " << duration3.count() << " ms" << endl;
-        cout << "快速排序: " << duration4.count() << " ms" << endl;
-        
-        delete[] arr1;
-        delete[] arr2;
-        delete[] arr3;
-        delete[] arr4;
+        ok = ok && is_sorted(work.begin(), work.end());
+        return chrono::duration<double, milli>(end - start).count();
+    }
+    
+public:
+    static void testSortingPerformance(uint64_t seed = 42) {
+        const int SIZE = 10000;
+        const int RANGE = 1000;
+        WorkloadGenerator generator(seed);
+        bool ok = true;
+        
+        cout << "排序性能测试 (数组大小: " << SIZE << ", 种子: " << seed << "):" << endl;
+        for (Distribution distribution : {Distribution::Uniform, Distribution::Sorted,
+                                          Distribution::ReverseSorted, Distribution::FewUnique,
+                                          Distribution::Zipfian, Distribution::OrganPipe}) {
+            // 数据在计时之外只生成一次，四种排序用同一份输入
+            vector<int> input = generator.generate(distribution, SIZE, RANGE);
+            
+            double bubble = timeSort(input, SortingAlgorithms::bubbleSort, ok);
+            double selection = timeSort(input, SortingAlgorithms::selectionSort, ok);
+            double insertion = timeSort(input, SortingAlgorithms::insertionSort, ok);
+            double quick = timeSort(input, [](int arr[], int size) {
+                SortingAlgorithms::quickSort(arr, 0, size - 1);
+            }, ok);
+            
+            cout << WorkloadGenerator::name(distribution) << ":" << endl;
+            cout << "  冒泡排序: " << bubble << " ms" << endl;
+            cout << "  选择排序: " << selection << " ms" << endl;
+            cout << "  插入排序: " << insertion << " ms" << endl;
+            cout << "  快速排序: " << quick << " ms" << endl;
+        }
+        cout << "排序结果正确: " << (ok ? "是" : "否") << endl;
     }
 };
 
@@ -619,19 +823,27 @@ int main() {
     
     // 练习5：二维数组操作
     cout << "\n=== 二维数组操作 ===" << endl;
-    int matrix[4][4] = {
+    Matrix<int> matrix = {
         {1, 2, 3, 4},
         {5, 6, 7, 8},
         {9, 10, 11, 12},
         {13, 14, 15, 16}
     };
     
-    MatrixOperations::printMatrix(matrix, 4, 4);
-    MatrixOperations::calculateSums(matrix, 4, 4);
+    MatrixOperations::printMatrix(matrix);
+    MatrixOperations::calculateSums(matrix);
     
-    auto pos2 = MatrixOperations::findElement(matrix, 4, 4, 7);
+    auto pos2 = MatrixOperations::findElement(matrix, 7);
     cout << "查找元素7的位置: (" << pos2.first << ", " << pos2.second << ")" << endl;
     
+    // 子矩阵视图共享原矩阵的存储
+    cout << "右下角2x3子矩阵的转置:" << endl;
+    MatrixOperations::printMatrix(MatrixOperations::transposeMatrix(matrix.submatrix(2, 1, 2, 3)));
+    
+    MatrixOperations::transposeInPlace(matrix);
+    cout << "原地转置后:" << endl;
+    MatrixOperations::printMatrix(matrix);
+    
     // 练习6：性能测试
     cout << "\n=== 性能测试 ===" << endl;
     PerformanceTest::testSortingPerformance();
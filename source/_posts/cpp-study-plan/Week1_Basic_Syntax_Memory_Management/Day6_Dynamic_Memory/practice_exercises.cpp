@@ -3,6 +3,13 @@
 #include <vector>
 #include <stdexcept>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <cstdlib>
+#ifdef __GLIBC__
+#include <malloc.h>  // malloc_usable_size
+#endif
 using namespace std;
 
 // 练习1：基本动态内存操作
@@ -432,43 +439,211 @@ public:
 };
 
 // 练习7：内存泄漏检测
-class MemoryLeakDetector {
+// 分配遥测快照：调用时刻各项计数的汇总
+struct AllocationSnapshot {
+    static const int kBuckets = 16;  // 第i个桶统计 (2^(i-1), 2^i] 字节的分配
+    
+    long long allocations = 0;
+    long long deallocations = 0;
+    long long bytesInUse = 0;      // 请求的字节数
+    long long highWater = 0;       // 使用中字节的峰值
+    long long liveBlocks = 0;      // 尚未释放的分配数
+    long long usableInUse = 0;     // malloc实际给出的字节数
+    double fragmentation = 0.0;    // 内部碎片：实际给出却没被请求的比例
+    array<long long, kBuckets> histogram{};
+    
+    void print() const {
+        cout << "内存分配次数: " << allocations << endl;
+        cout << "内存释放次数: " << deallocations << endl;
+        cout << "内存泄漏: " << liveBlocks << " 块, " << bytesInUse << " 字节" << endl;
+        cout << "使用中字节峰值: " << highWater << endl;
+        cout << "内部碎片率: " << fragmentation * 100 << "%" << endl;
+        cout << "分配大小分布:";
+        for (int i = 0; i < kBuckets; i++) {
+            if (histogram[i]) {
+                cout << " <=" << (1LL << i) << (i == kBuckets - 1 ? "+" : "") << ":" << histogram[i];
+            }
+        }
+        cout << endl;
+    }
+};
+
+// MemoryLeakDetector背后的全局计数：每个线程记自己的那份，不加锁，
+// printStats时再把各线程的数加起来。只有"峰值"要跨线程比较，见publishQuantum
+class AllocationTelemetry {
 private:
-    static int allocationCount;
-    static int deallocationCount;
+    struct ThreadCounters {
+        atomic<long long> allocations{0};
+        atomic<long long> deallocations{0};
+        atomic<long long> bytesAllocated{0};
+        atomic<long long> bytesFreed{0};
+        atomic<long long> usableAllocated{0};
+        atomic<long long> usableFreed{0};
+        array<atomic<long long>, AllocationSnapshot::kBuckets> histogram{};
+        long long unpublished = 0;  // 只有本线程访问
+    };
+    
+    static mutex& registryMutex() {
+        static mutex m;
+        return m;
+    }
+    
+    // 计数器在线程退出后仍保留，快照里包含已结束线程的数据
+    static vector<unique_ptr<ThreadCounters>>& allCounters() {
+        static vector<unique_ptr<ThreadCounters>> counters;
+        return counters;
+    }
+    
+    static ThreadCounters* registerThread() {
+        lock_guard<mutex> lock(registryMutex());
+        allCounters().push_back(make_unique<ThreadCounters>());
+        return allCounters().back().get();
+    }
+    
+    static ThreadCounters& local() {
+        thread_local ThreadCounters* counters = registerThread();
+        return *counters;
+    }
+    
+    // 单写者计数器：读改写不需要原子指令
+    static void add(atomic<long long>& counter, long long value) {
+        counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+    }
+    
+    static int bucketOf(size_t size) {
+        int bucket = 0;
+        while (bucket < AllocationSnapshot::kBuckets - 1 && (size_t(1) << bucket) < size) bucket++;
+        return bucket;
+    }
+    
+    static atomic<long long> publishedBytes;
+    static atomic<long long> highWater;
+    
+    static void publish(ThreadCounters& c) {
+        long long total = publishedBytes.fetch_add(c.unpublished, memory_order_relaxed) + c.unpublished;
+        c.unpublished = 0;
+        long long peak = highWater.load(memory_order_relaxed);
+        while (total > peak && !highWater.compare_exchange_weak(peak, total, memory_order_relaxed)) {
+        }
+    }
     
 public:
-    // 重载new和delete来跟踪内存分配
-    static void* operator new(size_t size) {
-        allocationCount++;
+    // 线程攒够这么多净字节才更新一次全局峰值；0表示每次都更新（峰值精确，但多线程时有共享写）
+    static long long publishQuantum;
+    
+    static void recordAllocation(size_t requested, size_t usable) {
+        ThreadCounters& c = local();
+        add(c.allocations, 1);
+        add(c.bytesAllocated, requested);
+        add(c.usableAllocated, usable);
+        add(c.histogram[bucketOf(requested)], 1);
+        c.unpublished += requested;
+        if (c.unpublished >= publishQuantum) publish(c);
+    }
+    
+    static void recordDeallocation(size_t requested, size_t usable) {
+        ThreadCounters& c = local();
+        add(c.deallocations, 1);
+        add(c.bytesFreed, requested);
+        add(c.usableFreed, usable);
+        c.unpublished -= requested;
+        if (-c.unpublished >= publishQuantum) publish(c);
+    }
+    
+    // 随时可调用；和正在进行的分配并发时得到近似一致的数值
+    static AllocationSnapshot snapshot() {
+        AllocationSnapshot s;
+        long long allocated = 0, freed = 0, usableAllocated = 0, usableFreed = 0;
+        lock_guard<mutex> lock(registryMutex());
+        for (const auto& c : allCounters()) {
+            s.allocations += c->allocations.load(memory_order_relaxed);
+            s.deallocations += c->deallocations.load(memory_order_relaxed);
+            allocated += c->bytesAllocated.load(memory_order_relaxed);
+            freed += c->bytesFreed.load(memory_order_relaxed);
+            usableAllocated += c->usableAllocated.load(memory_order_relaxed);
+            usableFreed += c->usableFreed.load(memory_order_relaxed);
+            for (int i = 0; i < AllocationSnapshot::kBuckets; i++) {
+                s.histogram[i] += c->histogram[i].load(memory_order_relaxed);
+            }
+        }
+        s.bytesInUse = allocated - freed;
+        s.liveBlocks = s.allocations - s.deallocations;
+        s.usableInUse = usableAllocated - usableFreed;
+        s.highWater = max(highWater.load(memory_order_relaxed), s.bytesInUse);
+        if (s.usableInUse > 0) {
+            s.fragmentation = 1.0 - double(s.bytesInUse) / s.usableInUse;
+        }
+        return s;
+    }
+    
+    // 清零所有计数（应在没有其他线程分配时调用）
+    static void reset() {
+        lock_guard<mutex> lock(registryMutex());
+        for (const auto& c : allCounters()) {
+            for (auto* counter : {&c->allocations, &c->deallocations, &c->bytesAllocated,
+                                  &c->bytesFreed, &c->usableAllocated, &c->usableFreed}) {
+                counter->store(0, memory_order_relaxed);
+            }
+            for (auto& bucket : c->histogram) bucket.store(0, memory_order_relaxed);
+            c->unpublished = 0;
+        }
+        publishedBytes.store(0);
+        highWater.store(0);
+    }
+};
+
+atomic<long long> AllocationTelemetry::publishedBytes{0};
+atomic<long long> AllocationTelemetry::highWater{0};
+long long AllocationTelemetry::publishQuantum = 0;
+
+class MemoryLeakDetector {
+private:
+    // malloc实际给出的字节数，用来估算内部碎片
+    static size_t usableSize(void* ptr, size_t size) {
+#ifdef __GLIBC__
+        (void)size;
+        return malloc_usable_size(ptr);
+#else
+        return size;
+#endif
+    }
+    
+    static void* allocate(size_t size) {
+        void* ptr = malloc(size);
+        if (!ptr) throw bad_alloc();
+        AllocationTelemetry::recordAllocation(size, usableSize(ptr, size));
         cout << "分配内存: " << size << " 字节" << endl;
-        return malloc(size);
+        return ptr;
     }
     
-    static void operator delete(void* ptr) {
-        deallocationCount++;
-        cout << "释放内存" << endl;
+    static void deallocate(void* ptr, size_t size) {
+        AllocationTelemetry::recordDeallocation(size, usableSize(ptr, size));
+        cout << "释放内存: " << size << " 字节" << endl;
         free(ptr);
     }
     
+    char payload[24] = {};
+    
+public:
+    // 重载new和delete来跟踪内存分配；带大小的delete让释放时也知道字节数
+    static void* operator new(size_t size) { return allocate(size); }
+    static void* operator new[](size_t size) { return allocate(size); }
+    static void operator delete(void* ptr, size_t size) { deallocate(ptr, size); }
+    static void operator delete[](void* ptr, size_t size) { deallocate(ptr, size); }
+    
+    ~MemoryLeakDetector() {}  // 非平凡析构：数组分配会带上元素个数的cookie
+    
     // 获取统计信息
     static void printStats() {
-        cout << "内存分配次数: " << allocationCount << endl;
-        cout << "内存释放次数: " << deallocationCount << endl;
-        cout << "内存泄漏: " << (allocationCount - deallocationCount) << endl;
+        AllocationTelemetry::snapshot().print();
     }
     
     // 重置统计
     static void resetStats() {
-        allocationCount = 0;
-        deallocationCount = 0;
+        AllocationTelemetry::reset();
     }
 };
 
-// 静态成员定义
-int MemoryLeakDetector::allocationCount = 0;
-int MemoryLeakDetector::deallocationCount = 0;
-
 int main() {
     cout << "C++ 动态内存管理练习" << endl;
     cout << "===================" << endl;
@@ -553,8 +728,10 @@ int main() {
     {
         MemoryLeakDetector* obj1 = new MemoryLeakDetector();
         MemoryLeakDetector* obj2 = new MemoryLeakDetector();
+        MemoryLeakDetector* batch = new MemoryLeakDetector[10];
         
         delete obj1;
+        delete[] batch;
         // 故意不删除obj2来演示内存泄漏
     }
     
@@ -2,13 +2,13 @@
  * 第23天：性能优化 - 实践练习
  * 
  * 本文件包含各种C++性能优化技巧的实际应用
- * 编译命令: g++ -std=c++17 -O2 -march=native -pthread -o practice_exercises practice_exercises.cpp
+ * 编译命令: g++ -std=c++17 -O2 -pthread -o practice_exercises practice_exercises.cpp
+ * SIMD内核运行时按CPU选择，不需要-march=native；只在本机运行时可选加上（见文件末尾的说明）
  */
 
 #include <iostream>
 #include <vector>
 #include <chrono>
-#include <random>
 #include <algorithm>
 #include <numeric>
 #include <memory>
@@ -17,18 +17,224 @@
 #include <array>
 #include <unordered_map>
 #include <stack>
+#include <string>
+#include <cmath>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <iterator>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <cstdlib>
+#include <new>
+#include <deque>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include <cstring>
+#include <cerrno>
+#include <memory_resource>
+#include <forward_list>
+#include <list>
+#include <iomanip>
+#include <tuple>
+#include <utility>
+#include <filesystem>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 // =============================================================================
 // 性能测试工具类
 // =============================================================================
 
+// JSON字符串转义；追踪文件、基准报告和遥测快照的导出共用。控制字符必须转义，否则不是合法JSON
+std::string escapeJSON(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                    out += code;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+// 层次化追踪分析器：每个线程写入自己预分配的环形缓冲区，热路径无锁
+// 作用域结束时记录一个完整事件，dump时导出为Chrome trace_event JSON
+class TraceProfiler {
+public:
+    struct Event {
+        const char* name;
+        uint64_t start_ns;
+        uint64_t end_ns;
+        uint32_t depth;
+    };
+    
+    struct ThreadBuffer {
+        std::unique_ptr<Event[]> events;
+        size_t capacity;                  // 2的幂，写满后覆盖最旧的事件
+        std::atomic<uint64_t> written{0};
+        uint32_t tid;
+        uint32_t depth = 0;               // 当前嵌套深度，只由所属线程访问
+        
+        ThreadBuffer(size_t cap, uint32_t id) : events(new Event[cap]), capacity(cap), tid(id) {}
+        
+        void record(const char* name, uint64_t start, uint64_t end) {
+            uint64_t index = written.load(std::memory_order_relaxed);
+            events[index & (capacity - 1)] = Event{name, start, end, depth};
+            written.store(index + 1, std::memory_order_release);
+        }
+    };
+    
+private:
+    std::atomic<bool> enabled_flag{false};
+    size_t buffer_capacity = 1 << 16;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::mutex registry_mutex;                            // 只保护线程注册和名字驻留
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;   // 线程退出后缓冲区仍然保留
+    std::set<std::string> interned_names;
+    
+public:
+    static TraceProfiler& instance() {
+        static TraceProfiler profiler;
+        return profiler;
+    }
+    
+    static bool enabled() {
+        return instance().enabled_flag.load(std::memory_order_relaxed);
+    }
+    
+    // 每线程事件数，需在enable之前设置
+    void enable(size_t events_per_thread = 1 << 16) {
+        size_t capacity = 1;
+        while (capacity < events_per_thread) capacity <<= 1;
+        buffer_capacity = capacity;
+        enabled_flag.store(true, std::memory_order_relaxed);
+    }
+    
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+    
+    // 首次调用时注册当前线程（加锁），之后只访问thread_local指针
+    ThreadBuffer& threadBuffer() {
+        thread_local ThreadBuffer* local = nullptr;
+        if (!local) {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>(
+                buffer_capacity, static_cast<uint32_t>(buffers.size() + 1)));
+            local = buffers.back().get();
+        }
+        return *local;
+    }
+    
+    // 动态名字（如基准名称）驻留为稳定的const char*，供事件引用
+    const char* intern(const std::string& name) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return interned_names.insert(name).first->c_str();
+    }
+    
+    // 导出时其他线程应已停止记录，否则可能读到正被覆盖的事件
+    void dump(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        bool first = true;
+        for (const auto& buffer : buffers) {
+            out << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                << "\"tid\": " << buffer->tid << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+            first = false;
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t begin = written > buffer->capacity ? written - buffer->capacity : 0;
+            for (uint64_t i = begin; i < written; ++i) {
+                const Event& e = buffer->events[i & (buffer->capacity - 1)];
+                out << ",\n  {\"name\": \"" << escapeJSON(e.name) << "\", \"ph\": \"X\", \"pid\": 1, "
+                    << "\"tid\": " << buffer->tid << ", \"ts\": " << e.start_ns / 1000.0
+                    << ", \"dur\": " << (e.end_ns - e.start_ns) / 1000.0
+                    << ", \"args\": {\"depth\": " << e.depth << "}}";
+            }
+        }
+        out << "\n]}\n";
+    }
+    
+    void dump(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("cannot write trace: " + path);
+        }
+        out.precision(15);
+        dump(out);
+    }
+};
+
+// RAII追踪作用域；未启用追踪时只有一次relaxed读
+class TraceScope {
+private:
+    const char* name;
+    uint64_t start_ns = 0;
+    TraceProfiler::ThreadBuffer* buffer = nullptr;
+    
+public:
+    explicit TraceScope(const char* scope_name) : name(scope_name) {
+        if (TraceProfiler::enabled()) {
+            buffer = &TraceProfiler::instance().threadBuffer();
+            ++buffer->depth;
+            start_ns = TraceProfiler::instance().now();
+        }
+    }
+    
+    ~TraceScope() {
+        if (buffer) {
+            uint64_t end_ns = TraceProfiler::instance().now();
+            --buffer->depth;
+            buffer->record(name, start_ns, end_ns);
+        }
+    }
+    
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_trace_scope_, __LINE__)(name)
+
+// 单行计时器，启用追踪时同时作为一个追踪作用域
 class PerformanceTimer {
 private:
     std::chrono::high_resolution_clock::time_point start_time;
     std::string operation_name;
+    TraceScope trace_scope;
     
 public:
-    PerformanceTimer(const std::string& name) : operation_name(name) {
+    PerformanceTimer(const std::string& name)
+        : operation_name(name),
+          trace_scope(TraceProfiler::enabled() ? TraceProfiler::instance().intern(name) : "") {
         start_time = std::chrono::high_resolution_clock::now();
     }
     
@@ -42,569 +248,6471 @@ public:
 
 #define BENCHMARK(name) PerformanceTimer _timer(name)
 
-// 多次运行基准测试
-template<typename Func>
-double benchmarkFunction(const std::string& name, Func&& func, int iterations = 100) {
-    std::vector<double> times;
-    times.reserve(iterations);
-    
-    // 热身运行
-    for (int i = 0; i < 5; ++i) {
-        func();
-    }
-    
-    // 正式测试
-    for (int i = 0; i < iterations; ++i) {
-        auto start = std::chrono::high_resolution_clock::now();
-        func();
-        auto end = std::chrono::high_resolution_clock::now();
-        
-        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            end - start).count();
-        times.push_back(duration);
-    }
-    
-    double average = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
-    double min_time = *std::min_element(times.begin(), times.end());
-    double max_time = *std::max_element(times.begin(), times.end());
-    
-    std::cout << name << " - Avg: " << average << " ns, Min: " << min_time 
-              << " ns, Max: " << max_time << " ns" << std::endl;
-    
-    return average;
-}
-
 // =============================================================================
-// 1. 缓存优化示例
+// 统计基准测试引擎
 // =============================================================================
 
-class CacheOptimization {
+// 测量参数：按时间预算自动校准迭代次数
+struct BenchmarkConfig {
+    double target_time_ms = 250.0;   // 每个基准的时间预算
+    double min_sample_ns = 20000.0;  // 单个样本的最短时长，避免时钟分辨率误差
+    size_t max_samples = 1000;       // 样本数上限
+    int warmup_runs = 5;             // 热身次数（受时间预算约束）
+    double outlier_threshold = 3.5;  // 离群阈值：|x - 中位数| > k * 1.4826 * MAD
+    bool hardware_counters = false;  // 采样阶段同时读取硬件性能计数器
+    bool full_sizes = false;         // 运行耗时较长的大尺寸用例
+    std::string telemetry_path;      // 分配遥测快照的导出文件（空表示只打印）
+};
+
+inline BenchmarkConfig& benchmarkConfig() {
+    static BenchmarkConfig config;
+    return config;
+}
+
+// 每次调用的硬件计数器平均值，不可用的计数器为NaN
+struct HardwareCounterValues {
+    bool valid = false;
+    double cycles = std::numeric_limits<double>::quiet_NaN();
+    double instructions = std::numeric_limits<double>::quiet_NaN();
+    double l1d_misses = std::numeric_limits<double>::quiet_NaN();
+    double llc_misses = std::numeric_limits<double>::quiet_NaN();
+    double branch_misses = std::numeric_limits<double>::quiet_NaN();
+};
+
+// 单个基准的统计结果（单位：每次调用的纳秒数）
+struct BenchmarkStats {
+    std::string name;
+    size_t samples = 0;              // 样本总数
+    size_t batch_size = 1;           // 每个样本包含的调用次数
+    size_t outliers = 0;             // 被剔除的离群样本数
+    double mean = 0.0;               // 剔除离群值后的均值
+    double stddev = 0.0;
+    double ci_low = 0.0;             // 均值的95%置信区间
+    double ci_high = 0.0;
+    double min = 0.0;                // 以下为全部样本的统计（尾部不做剔除）
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double mad = 0.0;                // 中位数绝对偏差
+    HardwareCounterValues counters;  // 仅在启用硬件计数器时有效
+};
+
+class BenchmarkStatistics {
 public:
-    // 矩阵乘法 - 缓存不友好版本
-    static void matrixMultiplyNaive(const std::vector<std::vector<double>>& A,
-                                   const std::vector<std::vector<double>>& B,
-                                   std::vector<std::vector<double>>& C) {
-        size_t n = A.size();
-        for (size_t i = 0; i < n; ++i) {
-            for (size_t j = 0; j < n; ++j) {
-                for (size_t k = 0; k < n; ++k) {
-                    C[i][j] += A[i][k] * B[k][j];  // B[k][j]访问不连续
-                }
-            }
-        }
-    }
-    
-    // 矩阵乘法 - 缓存友好版本（分块算法）
-    static void matrixMultiplyBlocked(const std::vector<std::vector<double>>& A,
-                                     const std::vector<std::vector<double>>& B,
-                                     std::vector<std::vector<double>>& C,
-                                     size_t block_size = 64) {
-        size_t n = A.size();
-        
-        for (size_t ii = 0; ii < n; ii += block_size) {
-            for (size_t jj = 0; jj < n; jj += block_size) {
-                for (size_t kk = 0; kk < n; kk += block_size) {
-                    // 分块内的计算
-                    size_t i_max = std::min(ii + block_size, n);
-                    size_t j_max = std::min(jj + block_size, n);
-                    size_t k_max = std::min(kk + block_size, n);
-                    
-                    for (size_t i = ii; i < i_max; ++i) {
-                        for (size_t j = jj; j < j_max; ++j) {
-                            double sum = 0.0;
-                            for (size_t k = kk; k < k_max; ++k) {
-                                sum += A[i][k] * B[k][j];
-                            }
-                            C[i][j] += sum;
-                        }
-                    }
-                }
-            }
-        }
+    // 线性插值百分位数，sorted必须已排序
+    static double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        double rank = p / 100.0 * (sorted.size() - 1);
+        size_t lower = static_cast<size_t>(rank);
+        size_t upper = std::min(lower + 1, sorted.size() - 1);
+        double fraction = rank - lower;
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
     }
     
-    // 一维数组版本（更缓存友好）
-    static void matrixMultiplyFlat(const std::vector<double>& A,
-                                  const std::vector<double>& B,
-                                  std::vector<double>& C,
-                                  size_t n) {
-        for (size_t i = 0; i < n; ++i) {
-            for (size_t k = 0; k < n; ++k) {
-                double a_ik = A[i * n + k];
-                for (size_t j = 0; j < n; ++j) {
-                    C[i * n + j] += a_ik * B[k * n + j];
-                }
-            }
-        }
+    // 双侧95%的t分布临界值，大样本时趋近1.96
+    static double tCritical95(size_t degrees_of_freedom) {
+        static const double table[] = {
+            0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+            2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+            2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+        if (degrees_of_freedom == 0) return 0.0;
+        if (degrees_of_freedom <= 30) return table[degrees_of_freedom];
+        if (degrees_of_freedom <= 60) return 2.000;
+        if (degrees_of_freedom <= 120) return 1.980;
+        return 1.960;
     }
     
-    // 测试缓存优化效果
-    static void testCacheOptimization() {
-        std::cout << "\n=== Cache Optimization Test ===\n";
-        
-        const size_t n = 256;
+    static BenchmarkStats compute(const std::string& name, std::vector<double> samples,
+                                  size_t batch_size, double outlier_threshold) {
+        BenchmarkStats stats;
+        stats.name = name;
+        stats.samples = samples.size();
+        stats.batch_size = batch_size;
+        if (samples.empty()) return stats;
         
-        // 初始化矩阵
-        std::vector<std::vector<double>> A(n, std::vector<double>(n, 1.0));
-        std::vector<std::vector<double>> B(n, std::vector<double>(n, 2.0));
-        std::vector<std::vector<double>> C1(n, std::vector<double>(n, 0.0));
-        std::vector<std::vector<double>> C2(n, std::vector<double>(n, 0.0));
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.p50 = percentile(samples, 50.0);
+        stats.p90 = percentile(samples, 90.0);
+        stats.p99 = percentile(samples, 99.0);
+        stats.p999 = percentile(samples, 99.9);
         
-        // 一维数组版本
-        std::vector<double> A_flat(n * n, 1.0);
-        std::vector<double> B_flat(n * n, 2.0);
-        std::vector<double> C_flat(n * n, 0.0);
+        std::vector<double> deviations(samples.size());
+        std::transform(samples.begin(), samples.end(), deviations.begin(),
+                       [&](double x) { return std::abs(x - stats.p50); });
+        std::sort(deviations.begin(), deviations.end());
+        stats.mad = percentile(deviations, 50.0);
         
-        // 测试朴素算法
-        benchmarkFunction("Matrix Multiply Naive", [&]() {
-            std::fill(C1.begin(), C1.end(), std::vector<double>(n, 0.0));
-            matrixMultiplyNaive(A, B, C1);
-        }, 3);
+        // 基于MAD的稳健离群剔除；MAD为0时（样本几乎相同）不剔除
+        std::vector<double> kept;
+        kept.reserve(samples.size());
+        double limit = outlier_threshold * 1.4826 * stats.mad;
+        for (double x : samples) {
+            if (stats.mad == 0.0 || std::abs(x - stats.p50) <= limit) {
+                kept.push_back(x);
+            }
+        }
+        stats.outliers = samples.size() - kept.size();
         
-        // 测试分块算法
-        benchmarkFunction("Matrix Multiply Blocked", [&]() {
-            std::fill(C2.begin(), C2.end(), std::vector<double>(n, 0.0));
-            matrixMultiplyBlocked(A, B, C2);
-        }, 3);
+        stats.mean = std::accumulate(kept.begin(), kept.end(), 0.0) / kept.size();
+        double squares = 0.0;
+        for (double x : kept) {
+            squares += (x - stats.mean) * (x - stats.mean);
+        }
+        stats.stddev = kept.size() > 1 ? std::sqrt(squares / (kept.size() - 1)) : 0.0;
         
-        // 测试一维数组版本
-        benchmarkFunction("Matrix Multiply Flat", [&]() {
-            std::fill(C_flat.begin(), C_flat.end(), 0.0);
-            matrixMultiplyFlat(A_flat, B_flat, C_flat, n);
-        }, 3);
+        double half_width = tCritical95(kept.size() - 1) * stats.stddev / std::sqrt(kept.size());
+        stats.ci_low = stats.mean - half_width;
+        stats.ci_high = stats.mean + half_width;
+        return stats;
+    }
+    
+    static void print(const BenchmarkStats& s) {
+        std::cout << s.name << " - Avg: " << s.mean << " ns (95% CI " << s.ci_low
+                  << " .. " << s.ci_high << "), SD: " << s.stddev << ", MAD: " << s.mad << "\n"
+                  << "    p50: " << s.p50 << ", p90: " << s.p90 << ", p99: " << s.p99
+                  << ", p99.9: " << s.p999 << ", Min: " << s.min << ", Max: " << s.max
+                  << " ns [" << s.samples << " samples x " << s.batch_size << " calls, "
+                  << s.outliers << " outliers]" << std::endl;
+        if (s.counters.valid) {
+            const HardwareCounterValues& c = s.counters;
+            std::cout << "    per call: cycles: " << c.cycles << ", instructions: " << c.instructions
+                      << " (IPC " << c.instructions / c.cycles << "), L1D misses: " << c.l1d_misses
+                      << ", LLC misses: " << c.llc_misses << ", branch misses: " << c.branch_misses
+                      << std::endl;
+        }
     }
 };
 
 // =============================================================================
-// 2. 内存池优化
+// 硬件性能计数器（Linux perf_event_open）
 // =============================================================================
 
-template<typename T, size_t BlockSize = 4096>
-class HighPerformanceMemoryPool {
-private:
-    struct Block {
-        alignas(T) char data[BlockSize];
-        Block* next = nullptr;
-    };
+// 打开一组独立计数器，在采样阶段前后启停；无权限或非Linux时退化为只计时
+class HardwareCounters {
+public:
+    enum Event { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, EventCount };
     
-    Block* current_block = nullptr;
-    char* current_pos = nullptr;
-    char* block_end = nullptr;
-    std::vector<std::unique_ptr<Block>> blocks;
+private:
+    std::array<int, EventCount> fds;
+    bool any_open = false;
+    std::string error_message;
     
-    void allocateNewBlock() {
-        auto block = std::make_unique<Block>();
-        current_pos = block->data;
-        block_end = block->data + BlockSize;
-        current_block = block.get();
-        blocks.push_back(std::move(block));
+#ifdef __linux__
+    static int openEvent(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;         // 计入之后创建的工作线程
+        attr.exclude_kernel = 1;  // perf_event_paranoid <= 2 时普通用户可用
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
     }
     
-public:
-    HighPerformanceMemoryPool() {
-        allocateNewBlock();
+    static uint64_t cacheReadMiss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
     }
+#endif
     
-    T* allocate() {
-        if (current_pos + sizeof(T) > block_end) {
-            allocateNewBlock();
+    HardwareCounters() {
+        fds.fill(-1);
+#ifdef __linux__
+        fds[Cycles] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (fds[Cycles] < 0) {
+            error_message = std::string("perf_event_open failed: ") + std::strerror(errno);
         }
-        
-        T* result = reinterpret_cast<T*>(current_pos);
-        current_pos += sizeof(T);
-        return result;
+        fds[Instructions] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[L1DMisses] = openEvent(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D));
+        fds[LLCMisses] = openEvent(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL));
+        fds[BranchMisses] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        any_open = std::any_of(fds.begin(), fds.end(), [](int fd) { return fd >= 0; });
+#else
+        error_message = "hardware counters require Linux perf_event_open";
+#endif
     }
     
-    void reset() {
-        if (!blocks.empty()) {
-            current_block = blocks[0].get();
-            current_pos = current_block->data;
-            block_end = current_block->data + BlockSize;
+public:
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+    
+    ~HardwareCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
         }
+#endif
     }
     
-    size_t getBlockCount() const { return blocks.size(); }
-    size_t getUsedMemory() const {
-        return blocks.size() * BlockSize - (block_end - current_pos);
+    static HardwareCounters& instance() {
+        static HardwareCounters counters;
+        return counters;
     }
-};
-
-// 使用内存池的高性能容器
-template<typename T>
-class PooledVector {
-private:
-    HighPerformanceMemoryPool<T>& pool;
-    T* data = nullptr;
-    size_t size_ = 0;
-    size_t capacity_ = 0;
     
-public:
-    PooledVector(HighPerformanceMemoryPool<T>& p) : pool(p) {}
+    bool available() const { return any_open; }
+    const std::string& error() const { return error_message; }
     
-    void push_back(const T& value) {
-        if (size_ == capacity_) {
-            reserve(capacity_ == 0 ? 1 : capacity_ * 2);
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
         }
-        new(data + size_) T(value);
-        ++size_;
+#endif
     }
     
-    void reserve(size_t new_capacity) {
-        if (new_capacity > capacity_) {
-            T* new_data = pool.allocate();  // 简化版本
-            if (data) {
-                for (size_t i = 0; i < size_; ++i) {
-                    new(new_data + i) T(std::move(data[i]));
-                    data[i].~T();
-                }
-            }
-            data = new_data;
-            capacity_ = new_capacity;
+    // 停止计数并换算为每次调用的平均值；计数器被复用时按运行时间比例缩放
+    HardwareCounterValues stop(double calls) {
+        HardwareCounterValues values;
+#ifdef __linux__
+        std::array<double, EventCount> per_call;
+        per_call.fill(std::numeric_limits<double>::quiet_NaN());
+        for (int e = 0; e < EventCount; ++e) {
+            if (fds[e] < 0) continue;
+            ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3] = {0, 0, 0};  // value, time_enabled, time_running
+            if (read(fds[e], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+            double scaled = static_cast<double>(data[0]) * data[1] / data[2];
+            per_call[e] = scaled / calls;
+            values.valid = true;
         }
+        values.cycles = per_call[Cycles];
+        values.instructions = per_call[Instructions];
+        values.l1d_misses = per_call[L1DMisses];
+        values.llc_misses = per_call[LLCMisses];
+        values.branch_misses = per_call[BranchMisses];
+#else
+        (void)calls;
+#endif
+        return values;
     }
-    
-    size_t size() const { return size_; }
-    T& operator[](size_t index) { return data[index]; }
-    const T& operator[](size_t index) const { return data[index]; }
 };
 
-// 测试内存池性能
-void testMemoryPool() {
-    std::cout << "\n=== Memory Pool Performance Test ===\n";
+// 运行一次完整测量：热身 -> 校准批大小和样本数 -> 采样 -> 统计
+// iterations为样本数下限，时间预算允许时会采集更多样本
+template<typename Func>
+BenchmarkStats runBenchmark(const std::string& name, Func&& func, int iterations = 100) {
+    using clock = std::chrono::steady_clock;
+    const BenchmarkConfig& config = benchmarkConfig();
+    const double budget_ns = config.target_time_ms * 1e6;
+    TraceScope benchmark_scope(TraceProfiler::enabled() ? TraceProfiler::instance().intern(name) : "");
     
-    const size_t num_allocations = 100000;
+    // 热身运行，同时估算单次调用耗时
+    double estimate_ns = 0.0;
+    double warmup_ns = 0.0;
+    int warmups = 0;
+    {
+        TRACE_SCOPE("warmup");
+        do {
+            auto start = clock::now();
+            func();
+            auto end = clock::now();
+            double elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+            warmup_ns += elapsed;
+            estimate_ns = elapsed;
+            ++warmups;
+        } while (warmups < config.warmup_runs && warmup_ns < budget_ns * 0.1);
+    }
+    estimate_ns = std::max(estimate_ns, 1.0);
     
-    // 测试标准分配器
-    benchmarkFunction("Standard Allocator", [&]() {
-        std::vector<int*> ptrs;
-        ptrs.reserve(num_allocations);
-        
-        for (size_t i = 0; i < num_allocations; ++i) {
-            ptrs.push_back(new int(i));
-        }
-        
-        for (auto ptr : ptrs) {
-            delete ptr;
-        }
-    }, 10);
+    // 过短的函数按批次计时，使每个样本都远大于时钟分辨率
+    size_t batch_size = std::max<size_t>(1, static_cast<size_t>(config.min_sample_ns / estimate_ns));
+    size_t min_samples = static_cast<size_t>(std::max(iterations, 1));
+    size_t budget_samples = static_cast<size_t>(budget_ns / (estimate_ns * batch_size));
+    size_t sample_count = std::min(std::max(min_samples, budget_samples),
+                                   std::max(min_samples, config.max_samples));
     
-    // 测试内存池
-    benchmarkFunction("Memory Pool", [&]() {
-        HighPerformanceMemoryPool<int> pool;
-        std::vector<int*> ptrs;
-        ptrs.reserve(num_allocations);
-        
-        for (size_t i = 0; i < num_allocations; ++i) {
-            int* ptr = pool.allocate();
-            *ptr = i;
-            ptrs.push_back(ptr);
+    HardwareCounters* counters = nullptr;
+    if (config.hardware_counters && HardwareCounters::instance().available()) {
+        counters = &HardwareCounters::instance();
+        counters->start();
+    }
+    
+    std::vector<double> samples;
+    samples.reserve(sample_count);
+    {
+        TRACE_SCOPE("sampling");
+        for (size_t s = 0; s < sample_count; ++s) {
+            auto start = clock::now();
+            for (size_t b = 0; b < batch_size; ++b) {
+                func();
+            }
+            auto end = clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / batch_size);
         }
-        
-        pool.reset();  // 快速释放所有内存
-    }, 10);
+    }
+    
+    HardwareCounterValues counter_values;
+    if (counters) {
+        counter_values = counters->stop(static_cast<double>(sample_count * batch_size));
+    }
+    
+    BenchmarkStats stats = BenchmarkStatistics::compute(name, std::move(samples), batch_size,
+                                                        config.outlier_threshold);
+    stats.counters = counter_values;
+    return stats;
 }
 
 // =============================================================================
-// 3. SIMD优化示例
+// 机器可读输出与基线对比
 // =============================================================================
 
-class SIMDOptimization {
+// 收集本次运行的全部结果，供JSON/CSV导出和基线对比使用
+class BenchmarkRegistry {
+private:
+    std::vector<BenchmarkStats> results;
+    
 public:
-    // 标量版本：数组求和
-    static double sumArrayScalar(const float* arr, size_t size) {
-        double sum = 0.0;
-        for (size_t i = 0; i < size; ++i) {
-            sum += arr[i];
+    static BenchmarkRegistry& instance() {
+        static BenchmarkRegistry registry;
+        return registry;
+    }
+    
+    void record(const BenchmarkStats& stats) { results.push_back(stats); }
+    const std::vector<BenchmarkStats>& getResults() const { return results; }
+};
+
+class BenchmarkReport {
+private:
+    static std::string escapeCSV(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"') out += '"';
+            out += c;
         }
-        return sum;
+        return out + "\"";
     }
     
-    // SIMD版本：数组求和（AVX）
-    static double sumArraySIMD(const float* arr, size_t size) {
-        __m256 sum_vec = _mm256_setzero_ps();
-        size_t simd_size = size - (size % 8);
+    // 只支持本文件写出的JSON子集：对象、数组、字符串和数字
+    class JSONReader {
+    private:
+        const std::string& text;
+        size_t pos = 0;
         
-        // SIMD处理
-        for (size_t i = 0; i < simd_size; i += 8) {
-            __m256 data = _mm256_loadu_ps(&arr[i]);
-            sum_vec = _mm256_add_ps(sum_vec, data);
+        void skipSpace() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
         }
         
-        // 水平求和
-        __m128 sum_high = _mm256_extractf128_ps(sum_vec, 1);
-        __m128 sum_low = _mm256_castps256_ps128(sum_vec);
-        __m128 sum_final = _mm_add_ps(sum_high, sum_low);
-        
-        sum_final = _mm_hadd_ps(sum_final, sum_final);
-        sum_final = _mm_hadd_ps(sum_final, sum_final);
-        
-        double result = _mm_cvtss_f32(sum_final);
-        
-        // 处理剩余元素
-        for (size_t i = simd_size; i < size; ++i) {
-            result += arr[i];
+        void expect(char c) {
+            skipSpace();
+            if (pos >= text.size() || text[pos] != c) {
+                throw std::runtime_error("baseline JSON: expected '" + std::string(1, c) +
+                                         "' at offset " + std::to_string(pos));
+            }
+            ++pos;
         }
         
-        return result;
-    }
-    
-    // 向量加法 - 标量版本
-    static void addArraysScalar(const float* a, const float* b, float* result, size_t size) {
-        for (size_t i = 0; i < size; ++i) {
-            result[i] = a[i] + b[i];
+        bool consume(char c) {
+            skipSpace();
+            if (pos < text.size() && text[pos] == c) { ++pos; return true; }
+            return false;
         }
-    }
-    
-    // 向量加法 - SIMD版本
-    static void addArraysSIMD(const float* a, const float* b, float* result, size_t size) {
-        size_t simd_size = size - (size % 8);
         
-        for (size_t i = 0; i < simd_size; i += 8) {
-            __m256 va = _mm256_loadu_ps(&a[i]);
-            __m256 vb = _mm256_loadu_ps(&b[i]);
-            __m256 vresult = _mm256_add_ps(va, vb);
-            _mm256_storeu_ps(&result[i], vresult);
+        std::string readString() {
+            expect('"');
+            std::string out;
+            while (pos < text.size() && text[pos] != '"') {
+                char c = text[pos++];
+                if (c != '\\' || pos >= text.size()) {
+                    out += c;
+                    continue;
+                }
+                char escaped = text[pos++];
+                switch (escaped) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': {
+                        if (pos + 4 > text.size()) {
+                            throw std::runtime_error("baseline JSON: truncated \\u escape at offset " +
+                                                     std::to_string(pos));
+                        }
+                        unsigned code = static_cast<unsigned>(std::stoul(text.substr(pos, 4), nullptr, 16));
+                        pos += 4;
+                        // 基本多文种平面内的码点按UTF-8写回（本文件只会写出\u00XX）
+                        if (code < 0x80) {
+                            out += static_cast<char>(code);
+                        } else if (code < 0x800) {
+                            out += static_cast<char>(0xC0 | (code >> 6));
+                            out += static_cast<char>(0x80 | (code & 0x3F));
+                        } else {
+                            out += static_cast<char>(0xE0 | (code >> 12));
+                            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                            out += static_cast<char>(0x80 | (code & 0x3F));
+                        }
+                        break;
+                    }
+                    default: out += escaped; break;  // \" \\ \/
+                }
+            }
+            expect('"');
+            return out;
         }
         
-        // 处理剩余元素
-        for (size_t i = simd_size; i < size; ++i) {
-            result[i] = a[i] + b[i];
+        double readNumber() {
+            skipSpace();
+            size_t used = 0;
+            double value = std::stod(text.substr(pos, 32), &used);
+            pos += used;
+            return value;
         }
-    }
-    
-    // 测试SIMD优化效果
-    static void testSIMDOptimization() {
-        std::cout << "\n=== SIMD Optimization Test ===\n";
         
-        const size_t size = 1000000;
+        BenchmarkStats readEntry() {
+            BenchmarkStats s;
+            expect('{');
+            if (consume('}')) return s;
+            do {
+                std::string key = readString();
+                expect(':');
+                skipSpace();
+                if (key == "name") { s.name = readString(); continue; }
+                double v = readNumber();
+                if (key == "samples") s.samples = static_cast<size_t>(v);
+                else if (key == "batch_size") s.batch_size = static_cast<size_t>(v);
+                else if (key == "outliers") s.outliers = static_cast<size_t>(v);
+                else if (key == "mean_ns") s.mean = v;
+                else if (key == "stddev_ns") s.stddev = v;
+                else if (key == "ci_low_ns") s.ci_low = v;
+                else if (key == "ci_high_ns") s.ci_high = v;
+                else if (key == "min_ns") s.min = v;
+                else if (key == "max_ns") s.max = v;
+                else if (key == "p50_ns") s.p50 = v;
+                else if (key == "p90_ns") s.p90 = v;
+                else if (key == "p99_ns") s.p99 = v;
+                else if (key == "p999_ns") s.p999 = v;
+                else if (key == "mad_ns") s.mad = v;
+                else if (key == "cycles") { s.counters.cycles = v; s.counters.valid = true; }
+                else if (key == "instructions") s.counters.instructions = v;
+                else if (key == "l1d_misses") s.counters.l1d_misses = v;
+                else if (key == "llc_misses") s.counters.llc_misses = v;
+                else if (key == "branch_misses") s.counters.branch_misses = v;
+            } while (consume(','));
+            expect('}');
+            return s;
+        }
         
-        // 初始化数据
-        std::vector<float> a(size), b(size), result1(size), result2(size);
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> dis(-100.0f, 100.0f);
+    public:
+        explicit JSONReader(const std::string& t) : text(t) {}
         
+        std::vector<BenchmarkStats> readBenchmarks() {
+            std::vector<BenchmarkStats> entries;
+            expect('{');
+            do {
+                std::string key = readString();
+                expect(':');
+                if (key != "benchmarks") {
+                    throw std::runtime_error("baseline JSON: unexpected key '" + key + "'");
+                }
+                expect('[');
+                if (consume(']')) continue;
+                do {
+                    entries.push_back(readEntry());
+                } while (consume(','));
+                expect(']');
+            } while (consume(','));
+            expect('}');
+            return entries;
+        }
+    };
+    
+    static std::vector<BenchmarkStats> parseCSV(std::istream& in) {
+        std::vector<BenchmarkStats> entries;
+        std::string line;
+        std::getline(in, line);  // 表头
+        while (std::getline(in, line)) {
+            if (line.empty()) continue;
+            BenchmarkStats s;
+            size_t pos = 0;
+            if (line[0] == '"') {
+                pos = 1;
+                while (pos < line.size()) {
+                    if (line[pos] == '"' && pos + 1 < line.size() && line[pos + 1] == '"') {
+                        s.name += '"';
+                        pos += 2;
+                    } else if (line[pos] == '"') {
+                        ++pos;
+                        break;
+                    } else {
+                        s.name += line[pos++];
+                    }
+                }
+            } else {
+                pos = line.find(',');
+                s.name = line.substr(0, pos);
+            }
+            std::vector<double> fields;
+            while (pos < line.size() && line[pos] == ',') {
+                size_t used = 0;
+                fields.push_back(std::stod(line.substr(pos + 1), &used));
+                pos += used + 1;
+            }
+            if (fields.size() != 14 && fields.size() != 19) {
+                throw std::runtime_error("baseline CSV: malformed row for '" + s.name + "'");
+            }
+            s.samples = static_cast<size_t>(fields[0]);
+            s.batch_size = static_cast<size_t>(fields[1]);
+            s.outliers = static_cast<size_t>(fields[2]);
+            s.mean = fields[3];   s.stddev = fields[4];
+            s.ci_low = fields[5]; s.ci_high = fields[6];
+            s.min = fields[7];    s.max = fields[8];
+            s.p50 = fields[9];    s.p90 = fields[10];
+            s.p99 = fields[11];   s.p999 = fields[12];
+            s.mad = fields[13];
+            if (fields.size() == 19) {
+                s.counters.cycles = fields[14];
+                s.counters.instructions = fields[15];
+                s.counters.l1d_misses = fields[16];
+                s.counters.llc_misses = fields[17];
+                s.counters.branch_misses = fields[18];
+                s.counters.valid = !std::isnan(fields[14]);
+            }
+            entries.push_back(s);
+        }
+        return entries;
+    }
+    
+public:
+    static void writeJSON(const std::vector<BenchmarkStats>& results, std::ostream& out) {
+        out << "{\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkStats& s = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << escapeJSON(s.name) << "\""
+                << ", \"samples\": " << s.samples << ", \"batch_size\": " << s.batch_size
+                << ", \"outliers\": " << s.outliers << ", \"mean_ns\": " << s.mean
+                << ", \"stddev_ns\": " << s.stddev << ", \"ci_low_ns\": " << s.ci_low
+                << ", \"ci_high_ns\": " << s.ci_high << ", \"min_ns\": " << s.min
+                << ", \"max_ns\": " << s.max << ", \"p50_ns\": " << s.p50
+                << ", \"p90_ns\": " << s.p90 << ", \"p99_ns\": " << s.p99
+                << ", \"p999_ns\": " << s.p999 << ", \"mad_ns\": " << s.mad;
+            if (s.counters.valid) {
+                // JSON没有NaN，缺失的计数器直接省略
+                const HardwareCounterValues& c = s.counters;
+                const std::pair<const char*, double> fields[] = {
+                    {"cycles", c.cycles}, {"instructions", c.instructions},
+                    {"l1d_misses", c.l1d_misses}, {"llc_misses", c.llc_misses},
+                    {"branch_misses", c.branch_misses}};
+                for (const auto& field : fields) {
+                    if (!std::isnan(field.second)) {
+                        out << ", \"" << field.first << "\": " << field.second;
+                    }
+                }
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+    
+    static void writeCSV(const std::vector<BenchmarkStats>& results, std::ostream& out) {
+        out << "name,samples,batch_size,outliers,mean_ns,stddev_ns,ci_low_ns,ci_high_ns,"
+               "min_ns,max_ns,p50_ns,p90_ns,p99_ns,p999_ns,mad_ns,"
+               "cycles,instructions,l1d_misses,llc_misses,branch_misses\n";
+        for (const BenchmarkStats& s : results) {
+            out << escapeCSV(s.name) << ',' << s.samples << ',' << s.batch_size << ','
+                << s.outliers << ',' << s.mean << ',' << s.stddev << ',' << s.ci_low << ','
+                << s.ci_high << ',' << s.min << ',' << s.max << ',' << s.p50 << ','
+                << s.p90 << ',' << s.p99 << ',' << s.p999 << ',' << s.mad << ','
+                << s.counters.cycles << ',' << s.counters.instructions << ','
+                << s.counters.l1d_misses << ',' << s.counters.llc_misses << ','
+                << s.counters.branch_misses << '\n';
+        }
+    }
+    
+    // 按文件扩展名选择格式
+    static void save(const std::vector<BenchmarkStats>& results, const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("cannot write benchmark report: " + path);
+        }
+        out.precision(10);
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        if (csv) {
+            writeCSV(results, out);
+        } else {
+            writeJSON(results, out);
+        }
+    }
+    
+    // 自动识别JSON（以'{'开头）或CSV基线文件
+    static std::vector<BenchmarkStats> loadBaseline(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot read baseline: " + path);
+        }
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t first = content.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && content[first] == '{') {
+            return JSONReader(content).readBenchmarks();
+        }
+        std::istringstream stream(content);
+        return parseCSV(stream);
+    }
+    
+    // Welch t检验：只有同时满足统计显著且超过相对阈值才算退化
+    // 返回退化的基准数量，CI可以据此决定是否失败
+    static size_t compare(const std::vector<BenchmarkStats>& baseline,
+                          const std::vector<BenchmarkStats>& current,
+                          double threshold = 0.05) {
+        std::cout << "\n=== Baseline Comparison (threshold " << threshold * 100 << "%) ===\n";
+        size_t regressions = 0;
+        for (const BenchmarkStats& now : current) {
+            auto it = std::find_if(baseline.begin(), baseline.end(),
+                                   [&](const BenchmarkStats& b) { return b.name == now.name; });
+            if (it == baseline.end()) {
+                std::cout << "NEW        " << now.name << std::endl;
+                continue;
+            }
+            const BenchmarkStats& base = *it;
+            double n1 = std::max<double>(1.0, base.samples - base.outliers);
+            double n2 = std::max<double>(1.0, now.samples - now.outliers);
+            double v1 = base.stddev * base.stddev / n1;
+            double v2 = now.stddev * now.stddev / n2;
+            double se = std::sqrt(v1 + v2);
+            double t = se > 0.0 ? (now.mean - base.mean) / se : 0.0;
+            // Welch-Satterthwaite自由度
+            double df_denominator = (n1 > 1 ? v1 * v1 / (n1 - 1) : 0.0) +
+                                    (n2 > 1 ? v2 * v2 / (n2 - 1) : 0.0);
+            size_t df = df_denominator > 0.0
+                ? static_cast<size_t>((v1 + v2) * (v1 + v2) / df_denominator) : 1;
+            double change = base.mean > 0.0 ? now.mean / base.mean - 1.0 : 0.0;
+            bool significant = se > 0.0 && std::abs(t) > BenchmarkStatistics::tCritical95(std::max<size_t>(df, 1));
+            
+            const char* verdict = "SAME      ";
+            if (significant && change > threshold) {
+                verdict = "REGRESSION";
+                ++regressions;
+            } else if (significant && change < -threshold) {
+                verdict = "IMPROVED  ";
+            }
+            std::cout << verdict << " " << now.name << ": " << base.mean << " -> " << now.mean
+                      << " ns (" << (change >= 0 ? "+" : "") << change * 100 << "%, t = " << t
+                      << ")" << std::endl;
+        }
+        std::cout << regressions << " regression(s) detected" << std::endl;
+        return regressions;
+    }
+};
+
+// 多次运行基准测试，打印完整统计并返回均值（纳秒）
+template<typename Func>
+double benchmarkFunction(const std::string& name, Func&& func, int iterations = 100) {
+    BenchmarkStats stats = runBenchmark(name, std::forward<Func>(func), iterations);
+    BenchmarkStatistics::print(stats);
+    BenchmarkRegistry::instance().record(stats);
+    return stats.mean;
+}
+
+// 基准名称里的数据量：按1024进位取整，如 "64 KiB"、"1 GiB"
+std::string formatBytes(size_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    size_t unit = 0;
+    while (bytes >= 1024 && bytes % 1024 == 0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        bytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(bytes) + " " + units[unit];
+}
+
+// =============================================================================
+// 测试数据：固定种子的随机数发生器、数据分布与磁盘缓存
+// =============================================================================
+
+// 所有基准的输入都由(全局种子, 数据流编号)决定，不同运行之间可以直接对比；
+// 整数区间和浮点映射都自己实现，不用std::*_distribution（其算法由实现定义，换标准库结果就变）
+
+// SplitMix64：把一个64位种子展开成发生器的初始状态
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**：256位状态，每个数只要几条指令；满足UniformRandomBitGenerator
+class Xoshiro256 {
+private:
+    uint64_t s[4];
+    
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    
+public:
+    using result_type = uint64_t;
+    
+    explicit Xoshiro256(uint64_t seed) {
+        for (uint64_t& word : s) word = splitMix64(seed);
+    }
+    
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+    
+    result_type operator()() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    
+    // [0, bound)内的整数：乘法取高位（Lemire），偏差不超过bound/2^64
+    uint64_t below(uint64_t bound) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>((*this)()) * bound) >> 64);
+    }
+    
+    // [0, 1)内的double，取高53位
+    double uniform() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+};
+
+// PCG32（XSH-RR）：只有16字节状态，适合在循环里按需抽取下标
+class Pcg32 {
+private:
+    uint64_t state = 0;
+    uint64_t increment;
+    
+public:
+    using result_type = uint32_t;
+    
+    explicit Pcg32(uint64_t seed, uint64_t stream = 0) : increment((stream << 1) | 1) {
+        (*this)();
+        state += seed;
+        (*this)();
+    }
+    
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+    
+    result_type operator()() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + increment;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rot = static_cast<uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+    
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * bound) >> 32);
+    }
+};
+
+enum class Distribution { Uniform, Sorted, ReverseSorted, FewUnique, Zipfian, OrganPipe };
+
+// 一份测试数据的完整描述：同一描述在同一全局种子下总是生成同样的数据
+struct WorkloadSpec {
+    Distribution distribution = Distribution::Uniform;
+    size_t size = 0;
+    double low = 0.0;       // 取值范围[low, high]；整数类型要求两端都在±2^53以内
+    double high = 1.0;
+    uint64_t stream = 0;    // 数据流编号：同一测试里的不同数组用不同编号
+    size_t unique = 16;     // FewUnique的不同取值个数
+    double skew = 0.99;     // Zipfian的指数（YCSB的默认值）
+};
+
+// 生成和缓存测试数据；数据都在计时区域之外一次生成好
+class Workload {
+private:
+    static constexpr char kMagic[8] = {'W', 'O', 'R', 'K', 'L', 'O', 'A', 'D'};
+    static constexpr uint64_t kFormatVersion = 1;
+    static constexpr size_t kCacheMinBytes = size_t(1) << 20;
+    static constexpr size_t kMaxZipfRanks = size_t(1) << 20;
+    
+    struct CacheHeader {
+        char magic[8];
+        uint64_t key;           // 描述、种子、元素类型和格式版本的哈希
+        uint64_t count;
+        uint64_t element_size;
+    };
+    
+    static inline uint64_t seed = 42;
+    static inline std::string cache_dir;
+    
+    template<typename T>
+    static T draw(Xoshiro256& rng, double low, double high) {
+        if constexpr (std::is_integral<T>::value) {
+            auto lo = static_cast<long long>(low);
+            uint64_t span = static_cast<uint64_t>(static_cast<long long>(high) - lo) + 1;
+            return static_cast<T>(lo + static_cast<long long>(rng.below(span)));
+        } else {
+            return static_cast<T>(low + (high - low) * rng.uniform());
+        }
+    }
+    
+    // 秩r（从0开始）的概率正比于1/(r+1)^skew；整数类型每个秩对应一个值，浮点类型均分区间
+    template<typename T>
+    static void fillZipfian(std::vector<T>& data, const WorkloadSpec& spec, Xoshiro256& rng) {
+        size_t ranks = kMaxZipfRanks;
+        if constexpr (std::is_integral<T>::value) {
+            ranks = std::min<size_t>(ranks, static_cast<size_t>(spec.high - spec.low) + 1);
+        }
+        std::vector<double> cdf(ranks);
+        double total = 0.0;
+        for (size_t r = 0; r < ranks; ++r) {
+            total += 1.0 / std::pow(static_cast<double>(r + 1), spec.skew);
+            cdf[r] = total;
+        }
+        for (T& x : data) {
+            double u = rng.uniform() * total;
+            size_t r = std::min<size_t>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), ranks - 1);
+            if constexpr (std::is_integral<T>::value) {
+                x = static_cast<T>(static_cast<long long>(spec.low) + static_cast<long long>(r));
+            } else {
+                x = static_cast<T>(spec.low + (spec.high - spec.low) * r / ranks);
+            }
+        }
+    }
+    
+    // 排序后偶数位从左往右升、奇数位从右往左降，得到左右对称的"管风琴"形状
+    template<typename T>
+    static void organPipe(std::vector<T>& data) {
+        std::vector<T> sorted(data);
+        std::sort(sorted.begin(), sorted.end());
+        const size_t n = data.size();
+        for (size_t i = 0; 2 * i < n; ++i) data[i] = sorted[2 * i];
+        for (size_t k = 0; 2 * k + 1 < n; ++k) data[n - 1 - k] = sorted[2 * k + 1];
+    }
+    
+    static uint64_t hashBytes(uint64_t hash, const void* bytes, size_t length) {
+        const auto* p = static_cast<const unsigned char*>(bytes);
+        for (size_t i = 0; i < length; ++i) {
+            hash = (hash ^ p[i]) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+    
+    template<typename T>
+    static uint64_t cacheKey(const WorkloadSpec& spec) {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto mix = [&](const auto& value) { hash = hashBytes(hash, &value, sizeof(value)); };
+        mix(kFormatVersion);
+        mix(seed);
+        mix(sizeof(T));
+        mix(std::is_integral<T>::value);
+        mix(std::is_signed<T>::value);
+        mix(spec.distribution);
+        mix(static_cast<uint64_t>(spec.size));
+        mix(spec.low);
+        mix(spec.high);
+        mix(spec.stream);
+        mix(static_cast<uint64_t>(spec.unique));
+        mix(spec.skew);
+        return hash;
+    }
+    
+    template<typename T>
+    static bool loadCached(const std::string& path, uint64_t key, std::vector<T>& data) {
+        std::ifstream in(path, std::ios::binary);
+        CacheHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.key != key ||
+            header.count != data.size() || header.element_size != sizeof(T)) {
+            return false;
+        }
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(data.data()),
+                                         static_cast<std::streamsize>(data.size() * sizeof(T))));
+    }
+    
+    // 先写临时文件再改名，中途失败不会留下截断的缓存；失败时返回false
+    template<typename T>
+    static bool storeCached(const std::string& path, uint64_t key, const std::vector<T>& data) {
+        std::error_code error;
+        std::filesystem::create_directories(cache_dir, error);
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            CacheHeader header;
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.key = key;
+            header.count = data.size();
+            header.element_size = sizeof(T);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(data.data()),
+                      static_cast<std::streamsize>(data.size() * sizeof(T)));
+            if (!out) {
+                out.close();
+                std::filesystem::remove(temp, error);
+                return false;
+            }
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0) {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+    
+public:
+    static void setSeed(uint64_t value) { seed = value; }
+    static uint64_t globalSeed() { return seed; }
+    
+    // 空目录关闭磁盘缓存
+    static void setCacheDir(const std::string& dir) { cache_dir = dir; }
+    static const std::string& cacheDir() { return cache_dir; }
+    
+    static const char* name(Distribution distribution) {
+        switch (distribution) {
+            case Distribution::Uniform: return "uniform";
+            case Distribution::Sorted: return "sorted";
+            case Distribution::ReverseSorted: return "reverse-sorted";
+            case Distribution::FewUnique: return "few-unique";
+            case Distribution::Zipfian: return "zipfian";
+            case Distribution::OrganPipe: return "organ-pipe";
+        }
+        return "unknown";
+    }
+    
+    // 第stream个数据流的发生器；不同编号的序列互不相关
+    static Xoshiro256 rng(uint64_t stream) {
+        uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ull);
+        return Xoshiro256(splitMix64(state));
+    }
+    
+    static Pcg32 pcg(uint64_t stream) { return Pcg32(seed, stream); }
+    
+    // Fisher-Yates；std::shuffle的交换顺序由实现定义，这里固定下来
+    template<typename T, typename Rng>
+    static void shuffle(std::vector<T>& data, Rng& generator) {
+        for (size_t i = data.size(); i > 1; --i) {
+            std::swap(data[i - 1], data[generator.below(static_cast<typename Rng::result_type>(i))]);
+        }
+    }
+    
+    // 直接生成，不经过缓存
+    template<typename T>
+    static std::vector<T> build(const WorkloadSpec& spec) {
+        static_assert(std::is_arithmetic<T>::value, "workloads hold arithmetic values");
+        Xoshiro256 generator = rng(spec.stream);
+        std::vector<T> data(spec.size);
+        if (spec.distribution == Distribution::Zipfian) {
+            fillZipfian(data, spec, generator);
+            return data;
+        }
+        if (spec.distribution == Distribution::FewUnique) {
+            std::vector<T> values(std::max<size_t>(spec.unique, 1));
+            for (T& value : values) value = draw<T>(generator, spec.low, spec.high);
+            for (T& x : data) x = values[generator.below(values.size())];
+            return data;
+        }
+        for (T& x : data) x = draw<T>(generator, spec.low, spec.high);
+        switch (spec.distribution) {
+            case Distribution::Sorted:
+                std::sort(data.begin(), data.end());
+                break;
+            case Distribution::ReverseSorted:
+                std::sort(data.begin(), data.end(), std::greater<T>());
+                break;
+            case Distribution::OrganPipe:
+                organPipe(data);
+                break;
+            default:
+                break;
+        }
+        return data;
+    }
+    
+    // 需要排序或查CDF的分布生成较慢，1 MiB以上的缓存到磁盘；均匀分布现算比读文件快
+    template<typename T>
+    static std::vector<T> generate(const WorkloadSpec& spec, bool* from_cache = nullptr) {
+        if (from_cache) *from_cache = false;
+        bool cacheable = !cache_dir.empty() && spec.size * sizeof(T) >= kCacheMinBytes &&
+                         spec.distribution != Distribution::Uniform &&
+                         spec.distribution != Distribution::FewUnique;
+        if (!cacheable) {
+            return build<T>(spec);
+        }
+        uint64_t key = cacheKey<T>(spec);
+        char key_hex[17];
+        std::snprintf(key_hex, sizeof(key_hex), "%016llx", static_cast<unsigned long long>(key));
+        std::string path = cache_dir + "/" + name(spec.distribution) + "-" + key_hex + ".bin";
+        
+        std::vector<T> data(spec.size);
+        if (loadCached(path, key, data)) {
+            if (from_cache) *from_cache = true;
+            return data;
+        }
+        data = build<T>(spec);
+        // 缓存目录不可写不影响测试：提示一次，之后都直接生成
+        if (!storeCached(path, key, data)) {
+            std::cout << "Workload cache disabled: cannot write " << path << "\n";
+            cache_dir.clear();
+        }
+        return data;
+    }
+    
+    // 抽查数据是否符合描述：等距取约1024个位置检查取值范围，有序分布再检查相邻抽样点的顺序；
+    // 用来核对缓存读出的数据，代价远小于重新生成
+    template<typename T>
+    static bool spotCheck(const WorkloadSpec& spec, const std::vector<T>& data) {
+        if (data.size() != spec.size) return false;
+        if (data.empty()) return true;
+        size_t step = std::max<size_t>(data.size() / 1024, 1);
+        const T* previous = nullptr;
+        for (size_t i = 0; i < data.size(); i += step) {
+            const T& x = data[i];
+            double value = static_cast<double>(x);
+            if (!(value >= spec.low && value <= spec.high)) return false;
+            if (previous) {
+                if (spec.distribution == Distribution::Sorted && x < *previous) return false;
+                if (spec.distribution == Distribution::ReverseSorted && *previous < x) return false;
+            }
+            previous = &x;
+        }
+        return true;
+    }
+};
+
+// =============================================================================
+// 并行工具：工作窃取线程池
+// =============================================================================
+
+// 每个参与者有自己的任务双端队列：自己从尾部取，空闲时从别人的头部偷
+// 调用线程作为0号参与者一起干活；parallelFor不可嵌套调用
+class WorkStealingPool {
+private:
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;  // queues[0]属于调用线程
+    
+    std::mutex run_mutex;                // 串行化并发的parallelFor调用
+    std::mutex state_mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation = 0;
+    size_t participants = 0;
+    size_t busy_workers = 0;
+    bool stopping = false;
+    const std::function<void(size_t)>* body = nullptr;
+    std::atomic<size_t> remaining{0};
+    std::exception_ptr first_error;
+    
+    bool popLocal(size_t self, size_t& task) {
+        WorkQueue& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+    
+    bool steal(size_t self, size_t& task) {
+        for (size_t offset = 1; offset < participants; ++offset) {
+            WorkQueue& victim = *queues[(self + offset) % participants];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void drain(size_t self) {
+        size_t task;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!popLocal(self, task) && !steal(self, task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            try {
+                (*body)(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (!first_error) first_error = std::current_exception();
+            }
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+    
+    void workerLoop(size_t self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(state_mutex);
+                start_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                if (self >= participants) continue;
+                ++busy_workers;
+            }
+            drain(self);
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                --busy_workers;
+            }
+            done_cv.notify_all();
+        }
+    }
+    
+public:
+    explicit WorkStealingPool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 0; i < threads; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+    
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    static WorkStealingPool& instance() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+    
+    size_t size() const { return queues.size(); }
+    
+    // 对[0, count)的每个任务调用task_body，最多使用max_threads个参与者（0表示全部）
+    // 任务按轮转预分到各队列，负载不均时由窃取平衡；任务抛出的第一个异常会被重新抛出
+    void parallelFor(size_t count, const std::function<void(size_t)>& task_body,
+                     size_t max_threads = 0) {
+        if (count == 0) return;
+        std::lock_guard<std::mutex> run_lock(run_mutex);
+        size_t used = max_threads == 0 ? size() : std::min(max_threads, size());
+        used = std::min(used, count);
+        for (size_t t = 0; t < count; ++t) {
+            std::lock_guard<std::mutex> lock(queues[t % used]->mutex);
+            queues[t % used]->tasks.push_back(t);
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            participants = used;
+            body = &task_body;
+            first_error = nullptr;
+            remaining.store(count, std::memory_order_release);
+            ++generation;
+        }
+        start_cv.notify_all();
+        drain(0);
+        
+        std::unique_lock<std::mutex> lock(state_mutex);
+        done_cv.wait(lock, [&] { return busy_workers == 0; });
+        body = nullptr;
+        if (first_error) {
+            std::rethrow_exception(first_error);
+        }
+    }
+};
+
+// 运行时CPU特性检测：整个文件按x86-64基线（SSE2）编译，带SIMD的内核用target属性
+// 单独生成各指令集版本，启动时按检测结果选择，旧机器上不会出现SIGILL。
+// --isa=可以强制使用较低的指令集，在同一台机器上测试每个版本
+enum class SimdLevel { Scalar, SSE2, AVX2, AVX512 };
+
+class CpuFeatures {
+private:
+    SimdLevel detected;
+    SimdLevel active;
+    bool popcnt = false;
+    
+    static bool detectPopcnt() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt");
+#else
+        return false;
+#endif
+    }
+    
+    static SimdLevel detect() {
+#if defined(__x86_64__) || defined(__i386__)
+        // __builtin_cpu_supports同时检查了操作系统是否保存对应的寄存器状态（XCR0）
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#endif
+        return SimdLevel::Scalar;
+    }
+    
+    CpuFeatures() : detected(detect()), active(detected), popcnt(detectPopcnt()) {}
+    
+public:
+    static CpuFeatures& instance() {
+        static CpuFeatures features;
+        return features;
+    }
+    
+    SimdLevel detectedLevel() const { return detected; }
+    SimdLevel level() const { return active; }
+    bool supports(SimdLevel level) const { return level <= detected; }
+    // POPCNT不属于SSE2，单独检测；强制为scalar时也不使用
+    bool hasPopcnt() const { return popcnt && active != SimdLevel::Scalar; }
+    
+    // 强制指令集；高于CPU支持的级别会在执行时SIGILL，所以直接拒绝
+    void force(SimdLevel level) {
+        if (!supports(level)) {
+            throw std::invalid_argument(std::string("CPU does not support ") + name(level));
+        }
+        active = level;
+    }
+    
+    static const char* name(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::Scalar: return "scalar";
+            case SimdLevel::SSE2: return "sse2";
+            case SimdLevel::AVX2: return "avx2";
+            case SimdLevel::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+    
+    static SimdLevel parse(const std::string& text) {
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (text == name(level)) return level;
+        }
+        throw std::invalid_argument("unknown ISA: " + text + " (expected scalar, sse2, avx2 or avx512)");
+    }
+};
+
+// =============================================================================
+// 1. 缓存优化示例
+// =============================================================================
+
+// GEMM分块参数：kc*NR的B微面板留在L1，mc*kc的A块留在L2，kc*nc的B块留在L3
+struct GemmBlocking {
+    size_t mc = 72;
+    size_t kc = 256;
+    size_t nc = 4080;
+};
+
+// BLIS/GotoBLAS风格的GEMM：A、B按L2/L1大小打包成连续面板，
+// 6x8的寄存器分块微内核在打包数据上做FMA，边缘块先算到临时块再写回
+class PackedGemm {
+public:
+    static constexpr size_t MR = 6;   // 微内核行数
+    static constexpr size_t NR = 8;   // 微内核列数（两个__m256d）
+    
+private:
+    // 64字节对齐的打包缓冲区，每个线程一份，按需增长
+    struct PackBuffer {
+        double* data = nullptr;
+        size_t capacity = 0;
+        
+        double* reserve(size_t count) {
+            if (count > capacity) {
+                std::free(data);
+                size_t bytes = (count * sizeof(double) + 63) / 64 * 64;
+                data = static_cast<double*>(std::aligned_alloc(64, bytes));
+                if (!data) throw std::bad_alloc();
+                capacity = count;
+            }
+            return data;
+        }
+        
+        ~PackBuffer() { std::free(data); }
+    };
+    
+    // 把A的mc x kc块打包成MR行的面板，每个面板按列连续存放，不足MR行补零
+    static void packA(const double* A, size_t lda, size_t mc, size_t kc, double* buffer) {
+        for (size_t i = 0; i < mc; i += MR) {
+            size_t rows = std::min(MR, mc - i);
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t r = 0; r < MR; ++r) {
+                    *buffer++ = r < rows ? A[(i + r) * lda + p] : 0.0;
+                }
+            }
+        }
+    }
+    
+    // 把B的kc x nc块打包成NR列的面板，每个面板按行连续存放，不足NR列补零
+    static void packB(const double* B, size_t ldb, size_t kc, size_t nc, double* buffer) {
+        for (size_t j = 0; j < nc; j += NR) {
+            size_t cols = std::min(NR, nc - j);
+            for (size_t p = 0; p < kc; ++p) {
+                const double* row = B + p * ldb + j;
+                for (size_t c = 0; c < NR; ++c) {
+                    *buffer++ = c < cols ? row[c] : 0.0;
+                }
+            }
+        }
+    }
+    
+    __attribute__((target("avx2")))
+    static void updateRow(double* row, __m256d lo, __m256d hi) {
+        _mm256_storeu_pd(row, _mm256_add_pd(_mm256_loadu_pd(row), lo));
+        _mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), hi));
+    }
+    
+    // C[MR x NR] += a_panel * b_panel（AVX2+FMA，运行时确认CPU支持后才会被调用）
+    __attribute__((target("avx2,fma")))
+    static void microKernel(size_t kc, const double* a, const double* b, double* C, size_t ldc) {
+        __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+        __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+        __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+        __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+        __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+        __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+        
+        for (size_t p = 0; p < kc; ++p) {
+            __m256d b0 = _mm256_load_pd(b);
+            __m256d b1 = _mm256_load_pd(b + 4);
+            __m256d a0 = _mm256_broadcast_sd(a + 0);
+            __m256d a1 = _mm256_broadcast_sd(a + 1);
+            c00 = _mm256_fmadd_pd(a0, b0, c00); c01 = _mm256_fmadd_pd(a0, b1, c01);
+            c10 = _mm256_fmadd_pd(a1, b0, c10); c11 = _mm256_fmadd_pd(a1, b1, c11);
+            __m256d a2 = _mm256_broadcast_sd(a + 2);
+            __m256d a3 = _mm256_broadcast_sd(a + 3);
+            c20 = _mm256_fmadd_pd(a2, b0, c20); c21 = _mm256_fmadd_pd(a2, b1, c21);
+            c30 = _mm256_fmadd_pd(a3, b0, c30); c31 = _mm256_fmadd_pd(a3, b1, c31);
+            __m256d a4 = _mm256_broadcast_sd(a + 4);
+            __m256d a5 = _mm256_broadcast_sd(a + 5);
+            c40 = _mm256_fmadd_pd(a4, b0, c40); c41 = _mm256_fmadd_pd(a4, b1, c41);
+            c50 = _mm256_fmadd_pd(a5, b0, c50); c51 = _mm256_fmadd_pd(a5, b1, c51);
+            a += MR;
+            b += NR;
+        }
+        
+        updateRow(C + 0 * ldc, c00, c01);
+        updateRow(C + 1 * ldc, c10, c11);
+        updateRow(C + 2 * ldc, c20, c21);
+        updateRow(C + 3 * ldc, c30, c31);
+        updateRow(C + 4 * ldc, c40, c41);
+        updateRow(C + 5 * ldc, c50, c51);
+    }
+    
+    // 标量回退：结构相同，依赖编译器自动向量化
+    static void microKernelScalar(size_t kc, const double* a, const double* b, double* C, size_t ldc) {
+        double acc[MR][NR] = {};
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t r = 0; r < MR; ++r) {
+                for (size_t c = 0; c < NR; ++c) {
+                    acc[r][c] += a[r] * b[c];
+                }
+            }
+            a += MR;
+            b += NR;
+        }
+        for (size_t r = 0; r < MR; ++r) {
+            for (size_t c = 0; c < NR; ++c) {
+                C[r * ldc + c] += acc[r][c];
+            }
+        }
+    }
+    
+    // 宏内核：遍历打包好的A块和B块，边缘块通过临时块处理
+    static void macroKernel(size_t mc, size_t nc, size_t kc, const double* packed_a,
+                            const double* packed_b, double* C, size_t ldc, bool scalar) {
+        bool vector = !scalar && CpuFeatures::instance().level() >= SimdLevel::AVX2;
+        auto kernel = vector ? microKernel : microKernelScalar;
+        for (size_t j = 0; j < nc; j += NR) {
+            size_t cols = std::min(NR, nc - j);
+            const double* b_panel = packed_b + j * kc;
+            for (size_t i = 0; i < mc; i += MR) {
+                size_t rows = std::min(MR, mc - i);
+                const double* a_panel = packed_a + i * kc;
+                double* c_tile = C + i * ldc + j;
+                if (rows == MR && cols == NR) {
+                    kernel(kc, a_panel, b_panel, c_tile, ldc);
+                } else {
+                    alignas(64) double edge[MR * NR] = {};
+                    kernel(kc, a_panel, b_panel, edge, NR);
+                    for (size_t r = 0; r < rows; ++r) {
+                        for (size_t c = 0; c < cols; ++c) {
+                            c_tile[r * ldc + c] += edge[r * NR + c];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+public:
+    // C(m x n) += A(m x k) * B(k x n)，均为行主序，lda/ldb/ldc为行跨度
+    static void multiply(const double* A, size_t lda, const double* B, size_t ldb,
+                         double* C, size_t ldc, size_t m, size_t n, size_t k,
+                         const GemmBlocking& blocking = GemmBlocking(), bool scalar = false) {
+        thread_local PackBuffer a_buffer, b_buffer;
+        size_t mc = (blocking.mc + MR - 1) / MR * MR;
+        size_t nc = (blocking.nc + NR - 1) / NR * NR;
+        size_t kc = blocking.kc;
+        double* packed_a = a_buffer.reserve(mc * kc);
+        double* packed_b = b_buffer.reserve(nc * kc);
+        
+        for (size_t jc = 0; jc < n; jc += nc) {
+            size_t nc_cur = std::min(nc, n - jc);
+            for (size_t pc = 0; pc < k; pc += kc) {
+                size_t kc_cur = std::min(kc, k - pc);
+                packB(B + pc * ldb + jc, ldb, kc_cur, nc_cur, packed_b);
+                for (size_t ic = 0; ic < m; ic += mc) {
+                    size_t mc_cur = std::min(mc, m - ic);
+                    packA(A + ic * lda + pc, lda, mc_cur, kc_cur, packed_a);
+                    macroKernel(mc_cur, nc_cur, kc_cur, packed_a, packed_b,
+                                C + ic * ldc + jc, ldc, scalar);
+                }
+            }
+        }
+    }
+    
+    // 打包kc x nc的B块所需的double个数（列数补齐到NR）
+    static size_t packedBSize(size_t kc, size_t nc) {
+        return (nc + NR - 1) / NR * NR * kc;
+    }
+    
+    // 供多个调用者共享的B块打包；buffer须32字节对齐且至少packedBSize(kc, nc)个元素
+    static void packPanelB(const double* B, size_t ldb, size_t kc, size_t nc, double* buffer) {
+        packB(B, ldb, kc, nc, buffer);
+    }
+    
+    // C(m x n) += A(m x kc) * 已打包的B(kc x n)，只打包A
+    static void multiplyPackedB(const double* A, size_t lda, const double* packed_b,
+                                double* C, size_t ldc, size_t m, size_t n, size_t kc,
+                                const GemmBlocking& blocking = GemmBlocking(), bool scalar = false) {
+        thread_local PackBuffer a_buffer;
+        size_t mc = (blocking.mc + MR - 1) / MR * MR;
+        double* packed_a = a_buffer.reserve(mc * kc);
+        for (size_t ic = 0; ic < m; ic += mc) {
+            size_t mc_cur = std::min(mc, m - ic);
+            packA(A + ic * lda, lda, mc_cur, kc, packed_a);
+            macroKernel(mc_cur, n, kc, packed_a, packed_b, C + ic * ldc, ldc, scalar);
+        }
+    }
+};
+
+// matrixMultiplyBlocked的(i, j, k)分块形状
+struct BlockShape {
+    size_t bi = 64;
+    size_t bj = 64;
+    size_t bk = 64;
+};
+
+// 分块大小自动调优：从sysfs读取缓存大小，在一组候选形状上计时，
+// 把最优形状连同CPU型号和缓存大小写入本地文件；换了机器文件自动失效
+class BlockSizeTuner {
+public:
+    struct CacheInfo {
+        size_t l1d = 32 * 1024;
+        size_t l2 = 1024 * 1024;
+        size_t l3 = 8 * 1024 * 1024;
+        std::string cpu = "unknown";
+        
+        bool operator==(const CacheInfo& other) const {
+            return l1d == other.l1d && l2 == other.l2 && l3 == other.l3 && cpu == other.cpu;
+        }
+    };
+    
+private:
+    CacheInfo caches = detectCaches();
+    BlockShape current = heuristicShape(caches);
+    bool tuned = false;
+    std::string path = defaultPath();
+    
+    // 调优结果属于机器而不属于源码目录：$XDG_CACHE_HOME（或~/.cache）下的cpp-study-plan目录，
+    // 两者都没有时才退回当前目录
+    static std::string defaultPath() {
+        const char* xdg = std::getenv("XDG_CACHE_HOME");
+        const char* home = std::getenv("HOME");
+        std::string dir;
+        if (xdg && *xdg) dir = xdg;
+        else if (home && *home) dir = std::string(home) + "/.cache";
+        else return "matmul_tuning.cfg";
+        return dir + "/cpp-study-plan/matmul_tuning.cfg";
+    }
+    
+    // 解析"48K"、"2048K"、"30M"这样的sysfs大小
+    static size_t parseSize(const std::string& text) {
+        size_t used = 0;
+        size_t value = std::stoul(text, &used);
+        char unit = used < text.size() ? static_cast<char>(std::toupper(text[used])) : 'B';
+        if (unit == 'K') value *= 1024;
+        if (unit == 'M') value *= 1024 * 1024;
+        if (unit == 'G') value *= 1024 * 1024 * 1024;
+        return value;
+    }
+    
+    static std::string readLine(const std::string& file) {
+        std::ifstream in(file);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+    
+    // 三个块都放进L1时的最大正方形分块，作为未调优时的默认值
+    static BlockShape heuristicShape(const CacheInfo& info) {
+        size_t block = 16;
+        while (3 * (block * 2) * (block * 2) * sizeof(double) <= info.l1d) {
+            block *= 2;
+        }
+        return BlockShape{block, block, block};
+    }
+    
+public:
+    static CacheInfo detectCaches() {
+        CacheInfo info;
+        for (int index = 0; index < 8; ++index) {
+            std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+            std::string level = readLine(dir + "level");
+            std::string type = readLine(dir + "type");
+            std::string size = readLine(dir + "size");
+            if (level.empty() || size.empty()) break;
+            try {
+                if (level == "1" && type == "Data") info.l1d = parseSize(size);
+                else if (level == "2" && type != "Instruction") info.l2 = parseSize(size);
+                else if (level == "3" && type != "Instruction") info.l3 = parseSize(size);
+            } catch (const std::exception&) {
+                // 格式异常时保留默认值
+            }
+        }
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.rfind("model name", 0) == 0) {
+                size_t colon = line.find(':');
+                info.cpu = line.substr(colon == std::string::npos ? 0 : colon + 2);
+                break;
+            }
+        }
+        return info;
+    }
+    
+    static BlockSizeTuner& instance() {
+        static BlockSizeTuner tuner;
+        return tuner;
+    }
+    
+    const CacheInfo& cacheInfo() const { return caches; }
+    const BlockShape& shape() const { return current; }
+    bool isTuned() const { return tuned; }
+    void setPath(const std::string& file) { path = file; }
+    const std::string& filePath() const { return path; }
+    
+    // 候选网格：三个块的工作集不超过L2的一半，且至少占L1的四分之一
+    std::vector<BlockShape> candidates() const {
+        std::vector<BlockShape> shapes;
+        const size_t sizes[] = {16, 32, 64, 128, 256};
+        for (size_t bi : sizes) {
+            for (size_t bj : sizes) {
+                for (size_t bk : sizes) {
+                    size_t working_set = (bi * bk + bk * bj + bi * bj) * sizeof(double);
+                    if (working_set <= caches.l2 / 2 && working_set >= caches.l1d / 4) {
+                        shapes.push_back(BlockShape{bi, bj, bk});
+                    }
+                }
+            }
+        }
+        return shapes;
+    }
+    
+    // 文件中的CPU型号或缓存大小与本机不符时返回false
+    bool load() {
+        std::ifstream in(path);
+        if (!in) return false;
+        CacheInfo saved;
+        BlockShape shape;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = line.substr(0, eq);
+            std::string value = line.substr(eq + 1);
+            try {
+                if (key == "cpu") saved.cpu = value;
+                else if (key == "l1d") saved.l1d = std::stoul(value);
+                else if (key == "l2") saved.l2 = std::stoul(value);
+                else if (key == "l3") saved.l3 = std::stoul(value);
+                else if (key == "bi") shape.bi = std::stoul(value);
+                else if (key == "bj") shape.bj = std::stoul(value);
+                else if (key == "bk") shape.bk = std::stoul(value);
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+        if (!(saved == caches) || shape.bi == 0 || shape.bj == 0 || shape.bk == 0) {
+            return false;
+        }
+        current = shape;
+        tuned = true;
+        return true;
+    }
+    
+    // 写不进去（只读HOME、沙箱）时返回false；调优结果仍在内存里，本次运行照常使用
+    bool save() const {
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::error_code error;
+            std::filesystem::create_directories(parent, error);
+        }
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        out << "# matrixMultiplyBlocked autotune result\n"
+            << "cpu=" << caches.cpu << "\nl1d=" << caches.l1d << "\nl2=" << caches.l2
+            << "\nl3=" << caches.l3 << "\nbi=" << current.bi << "\nbj=" << current.bj
+            << "\nbk=" << current.bk << "\n";
+        return static_cast<bool>(out.flush());
+    }
+    
+    // kernel执行一次给定形状的乘法；每个候选取2次中的最短时间
+    BlockShape tune(const std::function<void(const BlockShape&)>& kernel) {
+        TRACE_SCOPE("BlockSizeTuner::tune");
+        double best_time = std::numeric_limits<double>::max();
+        for (const BlockShape& shape : candidates()) {
+            double shape_time = std::numeric_limits<double>::max();
+            for (int run = 0; run < 2; ++run) {
+                auto start = std::chrono::steady_clock::now();
+                kernel(shape);
+                auto end = std::chrono::steady_clock::now();
+                shape_time = std::min(shape_time, std::chrono::duration<double, std::nano>(end - start).count());
+            }
+            if (shape_time < best_time) {
+                best_time = shape_time;
+                current = shape;
+            }
+        }
+        tuned = true;
+        return current;
+    }
+};
+
+// 64字节对齐的分配器，保证矩阵首地址落在缓存行边界
+template<typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template<typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+    
+    AlignedAllocator() = default;
+    template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+    
+    T* allocate(size_t count) {
+        size_t bytes = (count * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void* memory = std::aligned_alloc(Alignment, bytes);
+        if (!memory) throw std::bad_alloc();
+        return static_cast<T*>(memory);
+    }
+    
+    void deallocate(T* pointer, size_t) { std::free(pointer); }
+    
+    template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// 非拥有的行主序矩阵视图：首地址、行列数和行跨度，子矩阵只是换一个首地址
+template<typename T>
+class MatrixView {
+private:
+    T* data_;
+    size_t rows_;
+    size_t cols_;
+    size_t stride_;
+    
+public:
+    MatrixView(T* data, size_t rows, size_t cols, size_t stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+    
+    // MatrixView<T> -> MatrixView<const T>
+    template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    MatrixView(const MatrixView<U>& other)
+        : data_(other.data()), rows_(other.rows()), cols_(other.cols()), stride_(other.stride()) {}
+    
+    T& operator()(size_t i, size_t j) const { return data_[i * stride_ + j]; }
+    T* row(size_t i) const { return data_ + i * stride_; }
+    T* data() const { return data_; }
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+    
+    MatrixView submatrix(size_t row0, size_t col0, size_t rows, size_t cols) const {
+        return MatrixView(data_ + row0 * stride_ + col0, rows, cols, stride_);
+    }
+    
+    void fill(const T& value) const {
+        for (size_t i = 0; i < rows_; ++i) {
+            std::fill(row(i), row(i) + cols_, value);
+        }
+    }
+};
+
+// 连续存储的矩阵：一次分配、64字节对齐，行跨度补齐到整条缓存行；
+// 跨度恰为较大的2的幂时再多补一条缓存行，避免同一列的元素落在同一个缓存组
+template<typename T>
+class Matrix {
+private:
+    static constexpr size_t kLineElements = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+    
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t stride_ = 0;
+    std::vector<T, AlignedAllocator<T>> storage;
+    
+    static size_t paddedStride(size_t cols) {
+        size_t stride = (cols + kLineElements - 1) / kLineElements * kLineElements;
+        size_t bytes = stride * sizeof(T);
+        if (bytes >= 512 && (bytes & (bytes - 1)) == 0) {
+            stride += kLineElements;
+        }
+        return stride;
+    }
+    
+public:
+    Matrix() = default;
+    Matrix(size_t rows, size_t cols, const T& value = T())
+        : rows_(rows), cols_(cols), stride_(paddedStride(cols)), storage(rows * stride_, value) {}
+    
+    T& operator()(size_t i, size_t j) { return storage[i * stride_ + j]; }
+    const T& operator()(size_t i, size_t j) const { return storage[i * stride_ + j]; }
+    T* row(size_t i) { return storage.data() + i * stride_; }
+    const T* row(size_t i) const { return storage.data() + i * stride_; }
+    T* data() { return storage.data(); }
+    const T* data() const { return storage.data(); }
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+    
+    MatrixView<T> view() { return MatrixView<T>(data(), rows_, cols_, stride_); }
+    MatrixView<const T> view() const { return MatrixView<const T>(data(), rows_, cols_, stride_); }
+    operator MatrixView<T>() { return view(); }
+    operator MatrixView<const T>() const { return view(); }
+    
+    MatrixView<T> submatrix(size_t row0, size_t col0, size_t rows, size_t cols) {
+        return view().submatrix(row0, col0, rows, cols);
+    }
+    MatrixView<const T> submatrix(size_t row0, size_t col0, size_t rows, size_t cols) const {
+        return view().submatrix(row0, col0, rows, cols);
+    }
+    
+    // 填充包括补齐部分在内的全部存储
+    void fill(const T& value) { std::fill(storage.begin(), storage.end(), value); }
+};
+
+// 把C切成互不相交的块交给工作窃取线程池；块的列边界是8个double（一条缓存行）的整数倍，
+// 所以C首地址64字节对齐且ldc为8的倍数时任意两个线程都不会写同一缓存行，
+// 不满足时先写入对齐的临时矩阵再累加回C
+class ParallelTiledGemm {
+public:
+    enum class Kernel { Packed, Flat };
+    
+private:
+    // 每个线程至少分到几块，便于窃取平衡
+    static void chooseTile(size_t m, size_t n, size_t threads, size_t& tile_m, size_t& tile_n) {
+        tile_m = PackedGemm::MR * 12;  // 与GemmBlocking::mc一致
+        tile_n = n >= 1024 ? 256 : 64;
+        while (tile_n > 8 && ((m + tile_m - 1) / tile_m) * ((n + tile_n - 1) / tile_n) < threads * 4) {
+            tile_n /= 2;
+        }
+    }
+    
+    // 与CacheOptimization::matrixMultiplyFlat相同的i-k-j循环，限定在一个C块内
+    static void flatTile(const double* A, size_t lda, const double* B, size_t ldb, double* C,
+                         size_t ldc, size_t rows, size_t cols, size_t k) {
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t p = 0; p < k; ++p) {
+                double a_ip = A[i * lda + p];
+                const double* b_row = B + p * ldb;
+                double* c_row = C + i * ldc;
+                for (size_t j = 0; j < cols; ++j) {
+                    c_row[j] += a_ip * b_row[j];
+                }
+            }
+        }
+    }
+    
+    static void run(const double* A, size_t lda, const double* B, size_t ldb, double* C, size_t ldc,
+                    size_t m, size_t n, size_t k, size_t threads, Kernel kernel) {
+        WorkStealingPool& pool = WorkStealingPool::instance();
+        size_t used = threads == 0 ? pool.size() : std::min(threads, pool.size());
+        size_t tile_m, tile_n;
+        chooseTile(m, n, used, tile_m, tile_n);
+        size_t tiles_m = (m + tile_m - 1) / tile_m;
+        size_t tiles_n = (n + tile_n - 1) / tile_n;
+        
+        if (kernel == Kernel::Flat) {
+            pool.parallelFor(tiles_m * tiles_n, [&](size_t tile) {
+                size_t i0 = (tile / tiles_n) * tile_m;
+                size_t j0 = (tile % tiles_n) * tile_n;
+                flatTile(A + i0 * lda, lda, B + j0, ldb, C + i0 * ldc + j0, ldc,
+                         std::min(tile_m, m - i0), std::min(tile_n, n - j0), k);
+            }, used);
+            return;
+        }
+        
+        // 按kc切分k：每一段先把各列块的B面板并行打包一次，同一列的所有行块共享它，
+        // 再并行计算各C块，只剩A需要每块打包
+        size_t kc = GemmBlocking().kc;
+        size_t panel = PackedGemm::packedBSize(kc, tile_n);
+        std::vector<double, AlignedAllocator<double>> packed_b(panel * tiles_n);
+        for (size_t pc = 0; pc < k; pc += kc) {
+            size_t kc_cur = std::min(kc, k - pc);
+            pool.parallelFor(tiles_n, [&](size_t tn) {
+                size_t j0 = tn * tile_n;
+                PackedGemm::packPanelB(B + pc * ldb + j0, ldb, kc_cur, std::min(tile_n, n - j0),
+                                       packed_b.data() + tn * panel);
+            }, used);
+            pool.parallelFor(tiles_m * tiles_n, [&](size_t tile) {
+                size_t tn = tile % tiles_n;
+                size_t i0 = (tile / tiles_n) * tile_m;
+                size_t j0 = tn * tile_n;
+                PackedGemm::multiplyPackedB(A + i0 * lda + pc, lda, packed_b.data() + tn * panel,
+                                            C + i0 * ldc + j0, ldc, std::min(tile_m, m - i0),
+                                            std::min(tile_n, n - j0), kc_cur);
+            }, used);
+        }
+    }
+    
+public:
+    // C(m x n) += A(m x k) * B(k x n)，threads为0时使用全部硬件线程
+    static void multiply(const double* A, size_t lda, const double* B, size_t ldb,
+                         double* C, size_t ldc, size_t m, size_t n, size_t k,
+                         size_t threads = 0, Kernel kernel = Kernel::Packed) {
+        bool line_safe = reinterpret_cast<uintptr_t>(C) % 64 == 0 && ldc % 8 == 0;
+        if (line_safe) {
+            run(A, lda, B, ldb, C, ldc, m, n, k, threads, kernel);
+            return;
+        }
+        size_t padded = (n + 7) / 8 * 8;
+        std::vector<double, AlignedAllocator<double>> scratch(m * padded, 0.0);
+        run(A, lda, B, ldb, scratch.data(), padded, m, n, k, threads, kernel);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                C[i * ldc + j] += scratch[i * padded + j];
+            }
+        }
+    }
+};
+
+class CacheOptimization {
+public:
+    using ConstView = MatrixView<const double>;
+    using View = MatrixView<double>;
+    
+    // 矩阵乘法 - 缓存不友好版本
+    static void matrixMultiplyNaive(ConstView A, ConstView B, View C) {
+        size_t m = A.rows(), n = B.cols(), depth = A.cols();
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t k = 0; k < depth; ++k) {
+                    C(i, j) += A(i, k) * B(k, j);  // B(k, j)访问不连续
+                }
+            }
+        }
+    }
+    
+    // 矩阵乘法 - 缓存友好版本（分块算法）
+    static void matrixMultiplyBlocked(ConstView A, ConstView B, View C, const BlockShape& shape) {
+        size_t m = A.rows(), n = B.cols(), depth = A.cols();
+        
+        for (size_t ii = 0; ii < m; ii += shape.bi) {
+            for (size_t jj = 0; jj < n; jj += shape.bj) {
+                for (size_t kk = 0; kk < depth; kk += shape.bk) {
+                    // 分块内的计算
+                    size_t i_max = std::min(ii + shape.bi, m);
+                    size_t j_max = std::min(jj + shape.bj, n);
+                    size_t k_max = std::min(kk + shape.bk, depth);
+                    
+                    for (size_t i = ii; i < i_max; ++i) {
+                        for (size_t j = jj; j < j_max; ++j) {
+                            double sum = 0.0;
+                            for (size_t k = kk; k < k_max; ++k) {
+                                sum += A(i, k) * B(k, j);
+                            }
+                            C(i, j) += sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    // block_size为0时使用调优器当前的形状（已调优或按L1估算）
+    static void matrixMultiplyBlocked(ConstView A, ConstView B, View C, size_t block_size = 0) {
+        BlockShape shape = block_size == 0 ? BlockSizeTuner::instance().shape()
+                                           : BlockShape{block_size, block_size, block_size};
+        matrixMultiplyBlocked(A, B, C, shape);
+    }
+    
+    // i-k-j循环顺序：内层连续访问B和C的行（更缓存友好）
+    static void matrixMultiplyFlat(ConstView A, ConstView B, View C) {
+        size_t m = A.rows(), n = B.cols(), depth = A.cols();
+        for (size_t i = 0; i < m; ++i) {
+            double* c_row = C.row(i);
+            for (size_t k = 0; k < depth; ++k) {
+                double a_ik = A(i, k);
+                const double* b_row = B.row(k);
+                for (size_t j = 0; j < n; ++j) {
+                    c_row[j] += a_ik * b_row[j];
+                }
+            }
+        }
+    }
+    
+    // 缓存无关乘法的基础块大小：三个块约24 KiB，任何L1都放得下
+    static constexpr size_t kRecursiveBase = 32;
+    
+    // 基础块内核：一次处理C的4行，B的每一行被复用4次，内层j循环由编译器向量化
+    static void recursiveBaseKernel(ConstView A, ConstView B, View C) {
+        size_t m = A.rows(), n = B.cols(), depth = A.cols();
+        size_t i = 0;
+        for (; i + 4 <= m; i += 4) {
+            double* c0 = C.row(i);
+            double* c1 = C.row(i + 1);
+            double* c2 = C.row(i + 2);
+            double* c3 = C.row(i + 3);
+            for (size_t k = 0; k < depth; ++k) {
+                double a0 = A(i, k), a1 = A(i + 1, k), a2 = A(i + 2, k), a3 = A(i + 3, k);
+                const double* b_row = B.row(k);
+                for (size_t j = 0; j < n; ++j) {
+                    double b = b_row[j];
+                    c0[j] += a0 * b;
+                    c1[j] += a1 * b;
+                    c2[j] += a2 * b;
+                    c3[j] += a3 * b;
+                }
+            }
+        }
+        for (; i < m; ++i) {
+            double* c_row = C.row(i);
+            for (size_t k = 0; k < depth; ++k) {
+                double a_ik = A(i, k);
+                const double* b_row = B.row(k);
+                for (size_t j = 0; j < n; ++j) {
+                    c_row[j] += a_ik * b_row[j];
+                }
+            }
+        }
+    }
+    
+    // 缓存无关乘法：每次把m、n、k中最大的一维对半分，直到子问题进入基础块；
+    // 递归自然在每一级缓存上形成合适的分块，不需要知道缓存大小
+    static void matrixMultiplyRecursive(ConstView A, ConstView B, View C) {
+        size_t m = A.rows(), n = B.cols(), depth = A.cols();
+        if (m <= kRecursiveBase && n <= kRecursiveBase && depth <= kRecursiveBase) {
+            recursiveBaseKernel(A, B, C);
+            return;
+        }
+        if (m >= n && m >= depth) {
+            size_t half = m / 2;
+            matrixMultiplyRecursive(A.submatrix(0, 0, half, depth), B, C.submatrix(0, 0, half, n));
+            matrixMultiplyRecursive(A.submatrix(half, 0, m - half, depth), B,
+                                    C.submatrix(half, 0, m - half, n));
+        } else if (n >= depth) {
+            size_t half = n / 2;
+            matrixMultiplyRecursive(A, B.submatrix(0, 0, depth, half), C.submatrix(0, 0, m, half));
+            matrixMultiplyRecursive(A, B.submatrix(0, half, depth, n - half),
+                                    C.submatrix(0, half, m, n - half));
+        } else {
+            // 沿k切分时两半都累加到同一个C上，必须依次执行
+            size_t half = depth / 2;
+            matrixMultiplyRecursive(A.submatrix(0, 0, m, half), B.submatrix(0, 0, half, n), C);
+            matrixMultiplyRecursive(A.submatrix(0, half, m, depth - half),
+                                    B.submatrix(half, 0, depth - half, n), C);
+        }
+    }
+    
+    // 朴素转置：按行读、按列写，写入端每个元素跨一整行
+    static void transposeNaive(ConstView src, View dst) {
+        for (size_t i = 0; i < src.rows(); ++i) {
+            const double* src_row = src.row(i);
+            for (size_t j = 0; j < src.cols(); ++j) {
+                dst(j, i) = src_row[j];
+            }
+        }
+    }
+    
+    // 缓存无关转置：dst = src^T，沿较长的一维对半递归，16x16以内直接拷贝
+    static void transposeRecursive(ConstView src, View dst) {
+        size_t rows = src.rows(), cols = src.cols();
+        if (rows <= 16 && cols <= 16) {
+            transposeNaive(src, dst);
+        } else if (rows >= cols) {
+            size_t half = rows / 2;
+            transposeRecursive(src.submatrix(0, 0, half, cols), dst.submatrix(0, 0, cols, half));
+            transposeRecursive(src.submatrix(half, 0, rows - half, cols),
+                               dst.submatrix(0, half, cols, rows - half));
+        } else {
+            size_t half = cols / 2;
+            transposeRecursive(src.submatrix(0, 0, rows, half), dst.submatrix(0, 0, half, rows));
+            transposeRecursive(src.submatrix(0, half, rows, cols - half),
+                               dst.submatrix(half, 0, cols - half, rows));
+        }
+    }
+    
+    // 打包+寄存器分块的GEMM版本
+    static void matrixMultiplyPacked(ConstView A, ConstView B, View C, bool scalar = false) {
+        PackedGemm::multiply(A.data(), A.stride(), B.data(), B.stride(), C.data(), C.stride(),
+                             A.rows(), B.cols(), A.cols(), GemmBlocking(), scalar);
+    }
+    
+    // 并行版本：C按块分给工作窃取线程池，块内使用打包GEMM
+    static void matrixMultiplyParallel(ConstView A, ConstView B, View C, size_t threads = 0) {
+        ParallelTiledGemm::multiply(A.data(), A.stride(), B.data(), B.stride(), C.data(), C.stride(),
+                                    A.rows(), B.cols(), A.cols(), threads);
+    }
+    
+    // 并行i-k-j版本：块内为matrixMultiplyFlat的循环
+    static void matrixMultiplyFlatParallel(ConstView A, ConstView B, View C, size_t threads = 0) {
+        ParallelTiledGemm::multiply(A.data(), A.stride(), B.data(), B.stride(), C.data(), C.stride(),
+                                    A.rows(), B.cols(), A.cols(), threads,
+                                    ParallelTiledGemm::Kernel::Flat);
+    }
+    
+    static void fillRandom(Matrix<double>& M, Xoshiro256& gen) {
+        for (size_t i = 0; i < M.rows(); ++i) {
+            for (size_t j = 0; j < M.cols(); ++j) {
+                M(i, j) = -1.0 + 2.0 * gen.uniform();
+            }
+        }
+    }
+    
+    static double maxDifference(ConstView X, ConstView Y) {
+        double max_error = 0.0;
+        for (size_t i = 0; i < X.rows(); ++i) {
+            for (size_t j = 0; j < X.cols(); ++j) {
+                max_error = std::max(max_error, std::abs(X(i, j) - Y(i, j)));
+            }
+        }
+        return max_error;
+    }
+    
+    // 在不是分块整数倍的尺寸上对照matrixMultiplyFlat验证GEMM结果，
+    // 最后一组用子矩阵视图验证非零偏移和跨度
+    static bool verifyPackedGemm() {
+        Xoshiro256 gen = Workload::rng(42);
+        bool all_ok = true;
+        for (size_t n : {1, 5, 7, 13, 67, 131, 259}) {
+            Matrix<double> A(n, n), B(n, n);
+            fillRandom(A, gen);
+            fillRandom(B, gen);
+            
+            Matrix<double> expected(n, n, 0.5), simd(n, n, 0.5), scalar(n, n, 0.5);
+            matrixMultiplyFlat(A, B, expected);
+            matrixMultiplyPacked(A, B, simd);
+            matrixMultiplyPacked(A, B, scalar, true);
+            
+            double max_error = std::max(maxDifference(simd, expected), maxDifference(scalar, expected));
+            bool ok = max_error < 1e-9 * n;
+            all_ok = all_ok && ok;
+            std::cout << "GEMM check n=" << n << ": max error " << max_error
+                      << (ok ? " OK" : " FAILED") << std::endl;
+        }
+        
+        Matrix<double> big_a(100, 90), big_b(80, 70);
+        fillRandom(big_a, gen);
+        fillRandom(big_b, gen);
+        ConstView A = big_a.submatrix(3, 5, 37, 41);
+        ConstView B = big_b.submatrix(7, 2, 41, 29);
+        Matrix<double> expected(37, 29), packed(37, 29);
+        matrixMultiplyFlat(A, B, expected);
+        matrixMultiplyPacked(A, B, packed);
+        double max_error = maxDifference(packed, expected);
+        bool ok = max_error < 1e-9 * 41;
+        std::cout << "GEMM check 37x41 * 41x29 views: max error " << max_error
+                  << (ok ? " OK" : " FAILED") << std::endl;
+        return all_ok && ok;
+    }
+    
+    // 测试缓存优化效果：所有版本使用同一种对齐连续存储，只比较算法
+    static void testCacheOptimization() {
+        std::cout << "\n=== Cache Optimization Test ===\n";
+        TRACE_SCOPE("CacheOptimization::testCacheOptimization");
+        
+        const size_t n = 256;
+        
+        // 初始化矩阵
+        Matrix<double> A(n, n, 1.0);
+        Matrix<double> B(n, n, 2.0);
+        Matrix<double> C(n, n, 0.0);
+        std::cout << "Matrix " << n << "x" << n << ", row stride " << C.stride() << " doubles\n";
+        
+        // 测试朴素算法
+        benchmarkFunction("Matrix Multiply Naive", [&]() {
+            C.fill(0.0);
+            matrixMultiplyNaive(A, B, C);
+        }, 3);
+        
+        // main已尝试加载调优文件，没有可用结果时在这里调优并保存
+        BlockSizeTuner& tuner = BlockSizeTuner::instance();
+        const BlockSizeTuner::CacheInfo& caches = tuner.cacheInfo();
+        std::cout << "Caches: L1d " << caches.l1d / 1024 << " KiB, L2 " << caches.l2 / 1024
+                  << " KiB, L3 " << caches.l3 / 1024 << " KiB\n";
+        if (!tuner.isTuned()) {
+            std::cout << "Tuning block shape over " << tuner.candidates().size() << " candidates...\n";
+            tuner.tune([&](const BlockShape& shape) {
+                C.fill(0.0);
+                matrixMultiplyBlocked(A, B, C, shape);
+            });
+            if (tuner.save()) {
+                std::cout << "Saved tuning result to " << tuner.filePath() << "\n";
+            } else {
+                std::cout << "Tuning cache disabled: cannot write " << tuner.filePath() << "\n";
+            }
+        }
+        std::cout << "Block shape (i, j, k): " << tuner.shape().bi << ", " << tuner.shape().bj
+                  << ", " << tuner.shape().bk << "\n";
+        
+        // 测试分块算法
+        benchmarkFunction("Matrix Multiply Blocked (64)", [&]() {
+            C.fill(0.0);
+            matrixMultiplyBlocked(A, B, C, 64);
+        }, 3);
+        
+        benchmarkFunction("Matrix Multiply Blocked", [&]() {
+            C.fill(0.0);
+            matrixMultiplyBlocked(A, B, C);
+        }, 3);
+        
+        // 测试i-k-j版本
+        benchmarkFunction("Matrix Multiply Flat", [&]() {
+            C.fill(0.0);
+            matrixMultiplyFlat(A, B, C);
+        }, 3);
+        
+        // 测试打包GEMM版本
+        benchmarkFunction("Matrix Multiply Packed GEMM (scalar)", [&]() {
+            C.fill(0.0);
+            matrixMultiplyPacked(A, B, C, true);
+        }, 3);
+        
+        benchmarkFunction("Matrix Multiply Packed GEMM", [&]() {
+            C.fill(0.0);
+            matrixMultiplyPacked(A, B, C);
+        }, 3);
+        
+        if (!verifyPackedGemm()) {
+            throw std::runtime_error("packed GEMM does not match matrixMultiplyFlat");
+        }
+    }
+    
+    // 缓存无关版本与显式分块版本在非2的幂尺寸上的对比
+    static void testCacheOblivious() {
+        std::cout << "\n=== Cache-Oblivious Matrix Test ===\n";
+        TRACE_SCOPE("CacheOptimization::testCacheOblivious");
+        
+        Xoshiro256 gen = Workload::rng(7);
+        std::vector<size_t> sizes = {100, 333, 517};
+        if (benchmarkConfig().full_sizes) {
+            sizes.push_back(1000);
+        }
+        for (size_t n : sizes) {
+            Matrix<double> A(n, n), B(n, n), C(n, n), expected(n, n);
+            fillRandom(A, gen);
+            fillRandom(B, gen);
+            matrixMultiplyFlat(A, B, expected);
+            
+            std::string suffix = " n=" + std::to_string(n);
+            benchmarkFunction("Matrix Multiply Blocked" + suffix, [&]() {
+                C.fill(0.0);
+                matrixMultiplyBlocked(A, B, C);
+            }, 3);
+            benchmarkFunction("Matrix Multiply Recursive" + suffix, [&]() {
+                C.fill(0.0);
+                matrixMultiplyRecursive(A, B, C);
+            }, 3);
+            
+            double max_error = maxDifference(C, expected);
+            if (max_error > 1e-9 * n) {
+                throw std::runtime_error("recursive multiply does not match matrixMultiplyFlat");
+            }
+        }
+        
+        // 非方阵的转置，宽高都不是2的幂
+        std::vector<std::pair<size_t, size_t>> shapes = {{1000, 1500}, {1999, 777}};
+        if (benchmarkConfig().full_sizes) {
+            shapes.push_back({4001, 3999});
+        }
+        for (const auto& shape : shapes) {
+            Matrix<double> src(shape.first, shape.second), naive(shape.second, shape.first),
+                           recursive(shape.second, shape.first);
+            fillRandom(src, gen);
+            
+            std::string suffix = " " + std::to_string(shape.first) + "x" + std::to_string(shape.second);
+            benchmarkFunction("Transpose Naive" + suffix, [&]() {
+                transposeNaive(src, naive);
+            }, 10);
+            benchmarkFunction("Transpose Recursive" + suffix, [&]() {
+                transposeRecursive(src, recursive);
+            }, 10);
+            
+            if (maxDifference(naive, recursive) != 0.0) {
+                throw std::runtime_error("recursive transpose does not match naive transpose");
+            }
+        }
+    }
+    
+    // 1到N线程的加速比；n=4096只在--full时运行
+    static void testParallelScaling() {
+        std::cout << "\n=== Parallel Matrix Multiply Scaling ===\n";
+        TRACE_SCOPE("CacheOptimization::testParallelScaling");
+        
+        size_t hardware_threads = WorkStealingPool::instance().size();
+        std::vector<size_t> thread_counts;
+        for (size_t t = 1; t < hardware_threads; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(hardware_threads);
+        
+        std::vector<size_t> sizes = {256, 1024};
+        if (benchmarkConfig().full_sizes) {
+            sizes.push_back(4096);
+        }
+        
+        struct Row { std::string kernel; size_t n; size_t threads; double time_ns; };
+        std::vector<Row> rows;
+        Xoshiro256 gen = Workload::rng(11);
+        
+        // 在不是分块整数倍的尺寸上对照matrixMultiplyFlat检查整个C
+        {
+            const size_t n = 259;  // 大于kc，覆盖多段k和边缘块
+            Matrix<double> A(n, n), B(n, n), expected(n, n, 0.0);
+            fillRandom(A, gen);
+            fillRandom(B, gen);
+            matrixMultiplyFlat(A, B, expected);
+            for (size_t threads : thread_counts) {
+                Matrix<double> packed(n, n, 0.0), flat(n, n, 0.0);
+                matrixMultiplyParallel(A, B, packed, threads);
+                matrixMultiplyFlatParallel(A, B, flat, threads);
+                double max_error = std::max(maxDifference(packed, expected), maxDifference(flat, expected));
+                bool ok = max_error < 1e-9 * n;
+                std::cout << "Parallel GEMM check n=" << n << " threads=" << threads << ": max error "
+                          << max_error << (ok ? " OK" : " FAILED") << std::endl;
+                if (!ok) {
+                    throw std::runtime_error("parallel GEMM produced a wrong result");
+                }
+            }
+        }
+        
+        for (size_t n : sizes) {
+            Matrix<double> A(n, n), B(n, n), C(n, n, 0.0);
+            fillRandom(A, gen);
+            fillRandom(B, gen);
+            for (size_t threads : thread_counts) {
+                std::string suffix = " n=" + std::to_string(n) + " threads=" + std::to_string(threads);
+                double packed = benchmarkFunction("Parallel Packed GEMM" + suffix, [&]() {
+                    C.fill(0.0);
+                    matrixMultiplyParallel(A, B, C, threads);
+                }, 3);
+                rows.push_back({"Packed", n, threads, packed});
+                if (n <= 256) {
+                    double flat = benchmarkFunction("Parallel Flat" + suffix, [&]() {
+                        C.fill(0.0);
+                        matrixMultiplyFlatParallel(A, B, C, threads);
+                    }, 3);
+                    rows.push_back({"Flat", n, threads, flat});
+                }
+            }
+        }
+        
+        std::cout << "\nkernel  n     threads  GFLOP/s   speedup  efficiency\n";
+        for (const Row& row : rows) {
+            auto single = std::find_if(rows.begin(), rows.end(), [&](const Row& r) {
+                return r.kernel == row.kernel && r.n == row.n && r.threads == 1;
+            });
+            double speedup = single->time_ns / row.time_ns;
+            double gflops = 2.0 * row.n * row.n * row.n / row.time_ns;
+            std::cout << row.kernel << (row.kernel == "Flat" ? "    " : "  ") << row.n
+                      << std::string(6 - std::to_string(row.n).size(), ' ') << row.threads
+                      << std::string(9 - std::to_string(row.threads).size(), ' ') << gflops
+                      << "  " << speedup << "x  " << speedup / row.threads * 100 << "%\n";
+        }
+    }
+};
+
+// =============================================================================
+// 2. 内存池优化
+// =============================================================================
+
+// 分配遥测：计数器按线程分开，只由所属线程用relaxed读改写（单写者，不需要lock前缀），
+// 快照时汇总所有线程。使用中字节的峰值需要全局视角：各线程把净增量攒到
+// publish_quantum再发布到共享计数并更新峰值，所以峰值的误差不超过 线程数 × publish_quantum。
+// 块数和保留字节由分配器自己维护（池本身是单线程的）
+constexpr size_t kTelemetryBuckets = 24;  // 第i个桶统计 (2^(i-1), 2^i] 字节的分配，最后一桶收纳更大的
+
+struct TelemetrySnapshot {
+    std::string name;
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    int64_t bytes_in_use = 0;
+    int64_t high_water = 0;
+    uint64_t blocks = 0;
+    uint64_t reserved_bytes = 0;
+    double fragmentation = 0.0;  // 1 - 使用中字节/保留字节，即已向系统要来却没用上的比例
+    std::array<uint64_t, kTelemetryBuckets> histogram{};
+    
+    void print(std::ostream& out) const {
+        out << name << ": " << allocations << " allocs, " << deallocations << " frees, "
+            << bytes_in_use << " B in use (peak " << high_water << " B), " << blocks << " blocks / "
+            << reserved_bytes << " B reserved, fragmentation " << fragmentation * 100.0 << "%\n";
+        out << "  size histogram:";
+        for (size_t i = 0; i < kTelemetryBuckets; ++i) {
+            if (histogram[i]) {
+                out << " <=" << (size_t(1) << i) << (i + 1 == kTelemetryBuckets ? "+" : "") << ":" << histogram[i];
+            }
+        }
+        out << "\n";
+    }
+    
+    void writeJSON(std::ostream& out) const {
+        out << "{\"name\": \"" << escapeJSON(name) << "\", \"allocations\": " << allocations
+            << ", \"deallocations\": " << deallocations << ", \"bytes_in_use\": " << bytes_in_use
+            << ", \"high_water\": " << high_water << ", \"blocks\": " << blocks
+            << ", \"reserved_bytes\": " << reserved_bytes << ", \"fragmentation\": " << fragmentation
+            << ", \"histogram\": [";
+        for (size_t i = 0; i < kTelemetryBuckets; ++i) {
+            out << (i ? ", " : "") << histogram[i];
+        }
+        out << "]}";
+    }
+};
+
+class AllocationTelemetry {
+private:
+    struct alignas(64) ThreadCounters {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> deallocations{0};
+        std::atomic<uint64_t> bytes_allocated{0};
+        std::atomic<uint64_t> bytes_freed{0};
+        std::array<std::atomic<uint64_t>, kTelemetryBuckets> histogram{};
+        int64_t unpublished = 0;  // 只有所属线程访问
+    };
+    
+    // 最近使用的遥测对象；只含平凡类型，访问不经过thread_local的初始化守卫
+    struct LastUsed {
+        uint64_t id;
+        ThreadCounters* counters;
+    };
+    
+    std::string name;
+    uint64_t id;
+    int64_t publish_quantum;
+    std::mutex counters_mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> counters;
+    std::atomic<int64_t> published_bytes{0};
+    std::atomic<int64_t> high_water{0};
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> reserved_bytes{0};
+    
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    
+    static size_t bucketOf(size_t bytes) {
+        size_t bucket = bytes <= 1 ? 0 : 64 - __builtin_clzll(bytes - 1);
+        return std::min(bucket, kTelemetryBuckets - 1);
+    }
+    
+    static inline thread_local LastUsed last_used{0, nullptr};
+    
+    // 计数器归遥测对象所有，线程退出后仍然计入快照；id全局唯一，过期条目不会被误用
+    ThreadCounters& local() {
+        if (last_used.id == id) {
+            return *last_used.counters;
+        }
+        return localSlow();
+    }
+    
+    ThreadCounters& localSlow() {
+        thread_local std::vector<std::pair<uint64_t, ThreadCounters*>> entries;
+        ThreadCounters* found = nullptr;
+        for (const auto& entry : entries) {
+            if (entry.first == id) found = entry.second;
+        }
+        if (!found) {
+            std::lock_guard<std::mutex> lock(counters_mutex);
+            counters.push_back(std::make_unique<ThreadCounters>());
+            found = counters.back().get();
+            entries.emplace_back(id, found);
+        }
+        last_used = {id, found};
+        return *found;
+    }
+    
+    void publish(ThreadCounters& c) {
+        int64_t total = published_bytes.fetch_add(c.unpublished, std::memory_order_relaxed) + c.unpublished;
+        c.unpublished = 0;
+        int64_t peak = high_water.load(std::memory_order_relaxed);
+        while (total > peak && !high_water.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+        }
+    }
+    
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+    
+    static std::vector<AllocationTelemetry*>& registry() {
+        static std::vector<AllocationTelemetry*> instances;
+        return instances;
+    }
+    
+public:
+    explicit AllocationTelemetry(std::string telemetry_name, size_t quantum = 64 * 1024)
+        : name(std::move(telemetry_name)), publish_quantum(static_cast<int64_t>(quantum)) {
+        static std::atomic<uint64_t> next_id{0};
+        id = ++next_id;
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(this);
+    }
+    
+    ~AllocationTelemetry() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto& instances = registry();
+        instances.erase(std::remove(instances.begin(), instances.end(), this), instances.end());
+    }
+    
+    AllocationTelemetry(const AllocationTelemetry&) = delete;
+    AllocationTelemetry& operator=(const AllocationTelemetry&) = delete;
+    
+    void recordAllocation(size_t bytes) {
+        ThreadCounters& c = local();
+        add(c.allocations, 1);
+        add(c.bytes_allocated, bytes);
+        add(c.histogram[bucketOf(bytes)], 1);
+        if ((c.unpublished += static_cast<int64_t>(bytes)) >= publish_quantum) publish(c);
+    }
+    
+    // bytes是分配器实际交出的字节（池按槽位计）；count>1用于一次性丢弃多个对象（如池的reset）
+    void recordDeallocation(size_t bytes, size_t count = 1) {
+        ThreadCounters& c = local();
+        add(c.deallocations, count);
+        add(c.bytes_freed, bytes);
+        if ((c.unpublished -= static_cast<int64_t>(bytes)) <= -publish_quantum) publish(c);
+    }
+    
+    // 已有分配原地变大（不算一次新分配）
+    void recordGrowth(size_t bytes) {
+        ThreadCounters& c = local();
+        add(c.bytes_allocated, bytes);
+        if ((c.unpublished += static_cast<int64_t>(bytes)) >= publish_quantum) publish(c);
+    }
+    
+    void setBlocks(size_t block_count, size_t bytes) {
+        blocks.store(block_count, std::memory_order_relaxed);
+        reserved_bytes.store(bytes, std::memory_order_relaxed);
+    }
+    
+    // 随时可调用；与正在进行的分配并发时得到的是近似一致的数值
+    TelemetrySnapshot snapshot() {
+        TelemetrySnapshot s;
+        s.name = name;
+        uint64_t allocated = 0;
+        uint64_t freed = 0;
+        {
+            std::lock_guard<std::mutex> lock(counters_mutex);
+            for (const auto& c : counters) {
+                s.allocations += c->allocations.load(std::memory_order_relaxed);
+                s.deallocations += c->deallocations.load(std::memory_order_relaxed);
+                allocated += c->bytes_allocated.load(std::memory_order_relaxed);
+                freed += c->bytes_freed.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < kTelemetryBuckets; ++i) {
+                    s.histogram[i] += c->histogram[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        s.bytes_in_use = static_cast<int64_t>(allocated - freed);
+        s.high_water = std::max(high_water.load(std::memory_order_relaxed), s.bytes_in_use);
+        s.blocks = blocks.load(std::memory_order_relaxed);
+        s.reserved_bytes = reserved_bytes.load(std::memory_order_relaxed);
+        if (s.reserved_bytes) {
+            s.fragmentation = 1.0 - static_cast<double>(s.bytes_in_use) / s.reserved_bytes;
+        }
+        return s;
+    }
+    
+    static std::vector<TelemetrySnapshot> snapshotAll() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::vector<TelemetrySnapshot> snapshots;
+        for (AllocationTelemetry* telemetry : registry()) {
+            snapshots.push_back(telemetry->snapshot());
+        }
+        return snapshots;
+    }
+    
+    static void printAll(std::ostream& out) {
+        for (const TelemetrySnapshot& s : snapshotAll()) {
+            s.print(out);
+        }
+    }
+    
+    static void writeJSON(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("cannot write telemetry: " + path);
+        }
+        std::vector<TelemetrySnapshot> snapshots = snapshotAll();
+        out << "{\n  \"allocators\": [";
+        for (size_t i = 0; i < snapshots.size(); ++i) {
+            out << (i ? ",\n    " : "\n    ");
+            snapshots[i].writeJSON(out);
+        }
+        out << "\n  ]\n}\n";
+    }
+};
+
+// 块来源策略：allocate(size)返回按size对齐的size字节，deallocate(pointer, size)归还；
+// allocateSpan/deallocateSpan提供超过一个块的大段（按alignment对齐，大小是块的整数倍）。
+// 默认从全局堆按块对齐申请
+struct HeapBlockProvider {
+    void* allocate(size_t size) {
+        return ::operator new(size, std::align_val_t(size));
+    }
+    
+    void deallocate(void* pointer, size_t size) {
+        ::operator delete(pointer, std::align_val_t(size));
+    }
+    
+    void* allocateSpan(size_t bytes, size_t alignment) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    
+    void deallocateSpan(void* pointer, size_t, size_t alignment) {
+        ::operator delete(pointer, std::align_val_t(alignment));
+    }
+    
+    const char* describe() const { return "heap"; }
+};
+
+// 用mmap一次预留一大段区域再切成块，绕开全局堆。块大小是2 MiB的倍数时先试MAP_HUGETLB
+// （需要预留的大页，没有时mmap直接失败），失败则退回普通映射并用madvise请求透明大页。
+// 归还的块留在提供者的空闲链表里，物理页用MADV_DONTNEED交还内核，地址空间在析构时整体解除映射。
+// 大段（allocateSpan）各自单独映射，归还时直接解除映射
+class MmapBlockProvider {
+public:
+    enum class PageMode { Default, TransparentHuge, HugeTLB };
+    
+private:
+    static constexpr size_t kHugePageSize = size_t(2) << 20;
+    static constexpr size_t kRegionBytes = size_t(8) << 20;
+    
+    struct Region {
+        void* base;
+        size_t bytes;
+        size_t alignment;
+        bool mapped;     // false表示退回了全局堆
+        PageMode mode;
+    };
+    
+    std::vector<Region> regions;
+    std::vector<Region> spans;
+    std::vector<void*> free_blocks;
+    
+#ifdef __linux__
+    // 多映射size字节后裁掉首尾，得到按size对齐的区域
+    static void* mapAligned(size_t bytes, size_t alignment, int extra_flags) {
+        size_t reserve = bytes + alignment;
+        void* raw = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (aligned > start) munmap(raw, aligned - start);
+        size_t tail = start + reserve - (aligned + bytes);
+        if (tail) munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+        return reinterpret_cast<void*>(aligned);
+    }
+#endif
+    
+    // 按alignment对齐映射bytes字节；两者都是2 MiB的倍数时才尝试大页
+    static Region mapRegion(size_t bytes, size_t alignment) {
+        void* base = nullptr;
+        PageMode mode = PageMode::Default;
+#ifdef __linux__
+        bool huge_sized = bytes % kHugePageSize == 0 && alignment % kHugePageSize == 0;
+        if (huge_sized && (base = mapAligned(bytes, alignment, MAP_HUGETLB))) {
+            mode = PageMode::HugeTLB;
+        } else if ((base = mapAligned(bytes, alignment, 0))) {
+            if (huge_sized && madvise(base, bytes, MADV_HUGEPAGE) == 0) {
+                mode = PageMode::TransparentHuge;
+            }
+        }
+#endif
+        bool mapped = base != nullptr;
+        if (!mapped) {
+            // 非Linux或mmap失败：退回全局堆，整段区域仍按要求对齐
+            base = ::operator new(bytes, std::align_val_t(alignment));
+        }
+        return {base, bytes, alignment, mapped, mode};
+    }
+    
+    static void unmapRegion(const Region& region) {
+        if (region.mapped) {
+#ifdef __linux__
+            munmap(region.base, region.bytes);
+#endif
+        } else {
+            ::operator delete(region.base, std::align_val_t(region.alignment));
+        }
+    }
+    
+#ifdef __linux__
+    // /proc/self/smaps中与[base, base + bytes)重叠的映射实际由透明大页支撑的字节数
+    static size_t anonHugeBytes(const void* base, size_t bytes) {
+        std::ifstream smaps("/proc/self/smaps");
+        const uintptr_t low = reinterpret_cast<uintptr_t>(base);
+        const uintptr_t high = low + bytes;
+        bool inside = false;
+        size_t total = 0;
+        std::string line;
+        while (std::getline(smaps, line)) {
+            unsigned long long start = 0, end = 0;
+            if (std::sscanf(line.c_str(), "%llx-%llx", &start, &end) == 2) {
+                inside = start < high && end > low;
+            } else if (inside && line.rfind("AnonHugePages:", 0) == 0) {
+                total += std::stoull(line.substr(14)) * 1024;
+            }
+        }
+        return total;
+    }
+#endif
+    
+    void reserveRegion(size_t size) {
+        size_t bytes = std::max(size, kRegionBytes / size * size);
+        regions.push_back(mapRegion(bytes, size));
+        const Region& region = regions.back();
+        for (size_t offset = bytes; offset >= size; offset -= size) {
+            free_blocks.push_back(static_cast<char*>(region.base) + offset - size);
+        }
+    }
+    
+public:
+    MmapBlockProvider() = default;
+    MmapBlockProvider(const MmapBlockProvider&) = delete;
+    MmapBlockProvider& operator=(const MmapBlockProvider&) = delete;
+    
+    ~MmapBlockProvider() {
+        for (const Region& region : regions) unmapRegion(region);
+        for (const Region& span : spans) unmapRegion(span);
+    }
+    
+    void* allocate(size_t size) {
+        if (free_blocks.empty()) {
+            reserveRegion(size);
+        }
+        void* block = free_blocks.back();
+        free_blocks.pop_back();
+        return block;
+    }
+    
+    void deallocate(void* pointer, size_t size) {
+#ifdef __linux__
+        for (const Region& region : regions) {
+            if (pointer >= region.base && pointer < static_cast<char*>(region.base) + region.bytes) {
+                if (region.mapped && region.mode != PageMode::HugeTLB) {
+                    madvise(pointer, size, MADV_DONTNEED);
+                }
+                break;
+            }
+        }
+#endif
+        free_blocks.push_back(pointer);
+    }
+    
+    // 不小于2 MiB的大段按大页粒度映射，才有机会用上大页
+    void* allocateSpan(size_t bytes, size_t alignment) {
+        if (bytes >= kHugePageSize) {
+            bytes = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+            alignment = std::max(alignment, kHugePageSize);
+        }
+        spans.push_back(mapRegion(bytes, alignment));
+        return spans.back().base;
+    }
+    
+    void deallocateSpan(void* pointer, size_t, size_t) {
+        auto found = std::find_if(spans.begin(), spans.end(),
+                                  [&](const Region& span) { return span.base == pointer; });
+        if (found != spans.end()) {
+            unmapRegion(*found);
+            spans.erase(found);
+        }
+    }
+    
+    // 最近一次预留区域实际得到的页类型；TransparentHuge只表示madvise请求成功
+    PageMode pageMode() const { return regions.empty() ? PageMode::Default : regions.back().mode; }
+    
+    // madvise(MADV_HUGEPAGE)只是提示，透明大页是否真的生效要看smaps里的AnonHugePages
+    std::string describe() const {
+        switch (pageMode()) {
+            case PageMode::HugeTLB: return "mmap+MAP_HUGETLB";
+            case PageMode::TransparentHuge: {
+                size_t huge = 0, total = 0;
+#ifdef __linux__
+                for (const Region& region : regions) {
+                    if (region.mode != PageMode::TransparentHuge) continue;
+                    huge += anonHugeBytes(region.base, region.bytes);
+                    total += region.bytes;
+                }
+#endif
+                if (huge == 0) return "mmap (THP requested, none granted)";
+                return "mmap+THP (" + std::to_string(huge >> 20) + " of " + std::to_string(total >> 20) +
+                       " MiB in huge pages)";
+            }
+            default: return "mmap";
+        }
+    }
+};
+
+// 每个块按BlockSize对齐，块头放在块首，所以任意对象地址按位与即可找到所属块。
+// 每个块有自己的侵入式空闲链表（32位块内偏移，放在空闲槽位里）和存活计数，
+// 块在"当前/部分空闲/已满/全空"之间迁移；全空的块按保留上限还给块来源（BlockProvider）
+template<typename T, size_t BlockSize = 4096, typename BlockProvider = HeapBlockProvider>
+class HighPerformanceMemoryPool {
+private:
+    static_assert((BlockSize & (BlockSize - 1)) == 0, "BlockSize must be a power of two");
+    
+    enum class BlockState : uint8_t { Current, Partial, Full, Empty };
+    
+    struct BlockHeader {
+        BlockHeader* all_prev = nullptr;   // 全部块的链表
+        BlockHeader* all_next = nullptr;
+        BlockHeader* list_prev = nullptr;  // 所在的部分空闲链表或全空链表
+        BlockHeader* list_next = nullptr;
+        uint32_t free_head;                // 块内空闲链表头（偏移），kNoSlot表示空
+        uint32_t bump;                     // 尚未切分区域的起始偏移
+        uint32_t live = 0;                 // 存活对象数
+        BlockState state = BlockState::Current;
+    };
+    
+    // 超过一个块的数组单独向块来源申请，段首放这个头，串成侵入式链表供reset和析构统一归还
+    struct SpanHeader {
+        SpanHeader* prev;
+        SpanHeader* next;
+        size_t bytes;   // 向块来源申请的字节数
+        size_t slots;   // 遥测记录的槽位数
+    };
+    
+    static constexpr uint32_t kNoSlot = 0xFFFFFFFFu;
+    static constexpr size_t kSlotAlign = alignof(T) > alignof(uint32_t) ? alignof(T) : alignof(uint32_t);
+    static constexpr size_t kSlotSize =
+        ((sizeof(T) > sizeof(uint32_t) ? sizeof(T) : sizeof(uint32_t)) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+    static constexpr size_t kFirstSlot = (sizeof(BlockHeader) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+    static constexpr size_t kSlotsPerBlock = (BlockSize - kFirstSlot) / kSlotSize;
+    static_assert(BlockSize > kFirstSlot && kSlotsPerBlock > 0, "BlockSize too small for T");
+    static constexpr uint32_t kBlockEnd = static_cast<uint32_t>(kFirstSlot + kSlotsPerBlock * kSlotSize);
+    // 大段里数组的起始偏移：跳过段头，保持缓存行对齐
+    static constexpr size_t kSpanAlign = kSlotAlign > 64 ? kSlotAlign : 64;
+    static constexpr size_t kSpanFirst = (sizeof(SpanHeader) + kSpanAlign - 1) / kSpanAlign * kSpanAlign;
+    
+    struct List {
+        BlockHeader* head = nullptr;
+        size_t size = 0;
+        
+        void push(BlockHeader* block) {
+            block->list_prev = nullptr;
+            block->list_next = head;
+            if (head) head->list_prev = block;
+            head = block;
+            ++size;
+        }
+        
+        void remove(BlockHeader* block) {
+            if (block->list_prev) block->list_prev->list_next = block->list_next;
+            else head = block->list_next;
+            if (block->list_next) block->list_next->list_prev = block->list_prev;
+            --size;
+        }
+        
+        BlockHeader* pop() {
+            BlockHeader* block = head;
+            if (block) remove(block);
+            return block;
+        }
+    };
+    
+    BlockProvider provider;   // 先于各个块构造，最后析构
+    AllocationTelemetry* telemetry = nullptr;
+    BlockHeader* current_block = nullptr;
+    BlockHeader* all_blocks = nullptr;
+    List partial_blocks;
+    List empty_blocks;
+    SpanHeader* spans = nullptr;   // 尚未归还的大段
+    size_t span_count = 0;
+    size_t block_count = 0;
+    size_t live_objects = 0;       // 占用的槽位数（数组按槽位计）
+    size_t live_allocations = 0;   // 块内尚未归还的分配次数（reset按它记录释放次数）
+    size_t max_empty_blocks = 1;   // 保留的全空块数，避免在边界上反复向系统申请/归还
+    
+    static char* base(BlockHeader* block) { return reinterpret_cast<char*>(block); }
+    
+    static BlockHeader* blockOf(const void* pointer) {
+        return reinterpret_cast<BlockHeader*>(reinterpret_cast<uintptr_t>(pointer) & ~(BlockSize - 1));
+    }
+    
+    static bool hasCapacity(const BlockHeader* block) {
+        return block->free_head != kNoSlot || block->bump < kBlockEnd;
+    }
+    
+    static void resetBlock(BlockHeader* block) {
+        block->free_head = kNoSlot;
+        block->bump = static_cast<uint32_t>(kFirstSlot);
+        block->live = 0;
+    }
+    
+    BlockHeader* allocateNewBlock() {
+        void* memory = provider.allocate(BlockSize);
+        BlockHeader* block = new (memory) BlockHeader();
+        resetBlock(block);
+        block->all_next = all_blocks;
+        if (all_blocks) all_blocks->all_prev = block;
+        all_blocks = block;
+        ++block_count;
+        if (telemetry) telemetry->setBlocks(block_count, block_count * BlockSize);
+        return block;
+    }
+    
+    void releaseBlock(BlockHeader* block) {
+        if (block->all_prev) block->all_prev->all_next = block->all_next;
+        else all_blocks = block->all_next;
+        if (block->all_next) block->all_next->all_prev = block->all_prev;
+        block->~BlockHeader();
+        provider.deallocate(block, BlockSize);
+        --block_count;
+        if (telemetry) telemetry->setBlocks(block_count, block_count * BlockSize);
+    }
+    
+    // 全空的块先进入保留链表，超出上限的直接还给系统
+    void retireEmptyBlock(BlockHeader* block) {
+        resetBlock(block);
+        if (empty_blocks.size < max_empty_blocks) {
+            block->state = BlockState::Empty;
+            empty_blocks.push(block);
+        } else {
+            releaseBlock(block);
+        }
+    }
+    
+    // 当前块用完：依次尝试部分空闲块、保留的全空块、新块
+    T* allocateSlow() {
+        if (current_block) {
+            current_block->state = BlockState::Full;
+        }
+        BlockHeader* next = partial_blocks.pop();
+        // 部分空闲链表上不应有切满的块；万一有，归为已满并跳过
+        while (next && !hasCapacity(next)) {
+            next->state = BlockState::Full;
+            next = partial_blocks.pop();
+        }
+        if (!next) next = empty_blocks.pop();
+        if (!next) next = allocateNewBlock();
+        next->state = BlockState::Current;
+        current_block = next;
+        return allocateFrom(next);
+    }
+    
+    // 释放count个槽位后更新块状态：全空的块退役，原本满的块进入部分空闲链表
+    void releaseSlots(BlockHeader* block, size_t count) {
+        block->live -= static_cast<uint32_t>(count);
+        live_objects -= count;
+        
+        if (block->state == BlockState::Current) {
+            return;
+        }
+        if (block->live == 0) {
+            if (block->state == BlockState::Partial) {
+                partial_blocks.remove(block);
+            }
+            retireEmptyBlock(block);
+        } else if (block->state == BlockState::Full) {
+            block->state = BlockState::Partial;
+            partial_blocks.push(block);
+        }
+    }
+    
+    // 数组放不进当前块：换一个全空块作为当前块，旧的当前块按剩余空间归类
+    void replaceCurrentBlock() {
+        BlockHeader* old_block = current_block;
+        BlockHeader* next = empty_blocks.pop();
+        if (!next) next = allocateNewBlock();
+        if (old_block->live == 0) {
+            retireEmptyBlock(old_block);
+        } else if (hasCapacity(old_block)) {
+            old_block->state = BlockState::Partial;
+            partial_blocks.push(old_block);
+        } else {
+            old_block->state = BlockState::Full;
+        }
+        next->state = BlockState::Current;
+        current_block = next;
+    }
+    
+    // count个连续的T占用的槽位数（槽位可能因对齐比T大）
+    static constexpr size_t slotsFor(size_t count) {
+        return (count * sizeof(T) + kSlotSize - 1) / kSlotSize;
+    }
+    
+    void releaseSpan(SpanHeader* span) {
+        if (span->prev) span->prev->next = span->next;
+        else spans = span->next;
+        if (span->next) span->next->prev = span->prev;
+        --span_count;
+        size_t bytes = span->bytes;
+        span->~SpanHeader();
+        provider.deallocateSpan(span, bytes, BlockSize);
+    }
+    
+    T* allocateFrom(BlockHeader* block) {
+        char* slot;
+        if (block->free_head != kNoSlot) {
+            slot = base(block) + block->free_head;
+            block->free_head = *reinterpret_cast<uint32_t*>(slot);
+        } else {
+            slot = base(block) + block->bump;
+            block->bump += static_cast<uint32_t>(kSlotSize);
+        }
+        ++block->live;
+        ++live_objects;
+        ++live_allocations;
+        if (telemetry) telemetry->recordAllocation(kSlotSize);
+        return reinterpret_cast<T*>(slot);
+    }
+    
+public:
+    HighPerformanceMemoryPool() {
+        current_block = allocateNewBlock();
+    }
+    
+    ~HighPerformanceMemoryPool() {
+        while (spans) {
+            releaseSpan(spans);
+        }
+        while (all_blocks) {
+            releaseBlock(all_blocks);
+        }
+    }
+    
+    HighPerformanceMemoryPool(const HighPerformanceMemoryPool&) = delete;
+    HighPerformanceMemoryPool& operator=(const HighPerformanceMemoryPool&) = delete;
+    
+    // 分配未初始化的T大小内存
+    T* allocate() {
+        BlockHeader* block = current_block;
+        if (hasCapacity(block)) {
+            return allocateFrom(block);
+        }
+        return allocateSlow();
+    }
+    
+    // 归还一个由本池分配的槽位（不调用析构函数）
+    void deallocate(T* pointer) {
+        if (!pointer) return;
+        BlockHeader* block = blockOf(pointer);
+        char* slot = reinterpret_cast<char*>(pointer);
+        *reinterpret_cast<uint32_t*>(slot) = block->free_head;
+        block->free_head = static_cast<uint32_t>(slot - base(block));
+        releaseSlots(block, 1);
+        --live_allocations;
+        if (telemetry) telemetry->recordDeallocation(kSlotSize);
+    }
+    
+    // 超过一个块容量的数组占用的大段字节数（含段头，块的整数倍）
+    static constexpr size_t spanBytes(size_t count) {
+        return (kSpanFirst + count * sizeof(T) + BlockSize - 1) / BlockSize * BlockSize;
+    }
+    
+    // 分配能容纳count个T的连续内存（未初始化），从当前块的未切分区域整段切出；
+    // 超过一个块容量的数组向块来源单独申请一段（同样可以来自mmap/大页），
+    // 这些段仍归池所有：reset和析构时与块一起归还
+    T* allocateArray(size_t count) {
+        size_t slots = slotsFor(count);
+        if (slots <= 1) {
+            return allocate();
+        }
+        if (slots > kSlotsPerBlock) {
+            size_t bytes = spanBytes(count);
+            void* memory = provider.allocateSpan(bytes, BlockSize);
+            SpanHeader* span = new (memory) SpanHeader{nullptr, spans, bytes, slots};
+            if (spans) spans->prev = span;
+            spans = span;
+            ++span_count;
+            if (telemetry) telemetry->recordAllocation(slots * kSlotSize);
+            return reinterpret_cast<T*>(reinterpret_cast<char*>(span) + kSpanFirst);
+        }
+        uint32_t bytes = static_cast<uint32_t>(slots * kSlotSize);
+        if (current_block->bump + bytes > kBlockEnd) {
+            replaceCurrentBlock();
+        }
+        BlockHeader* block = current_block;
+        char* array = base(block) + block->bump;
+        block->bump += bytes;
+        block->live += static_cast<uint32_t>(slots);
+        live_objects += slots;
+        ++live_allocations;
+        if (telemetry) telemetry->recordAllocation(bytes);
+        return reinterpret_cast<T*>(array);
+    }
+    
+    // 归还allocateArray得到的内存；数组正好位于未切分区域之前时直接回退切分位置，
+    // 否则把它拆成单个槽位挂回块内空闲链表
+    void deallocateArray(T* pointer, size_t count) {
+        if (!pointer) return;
+        size_t slots = slotsFor(count);
+        if (slots <= 1) {
+            deallocate(pointer);
+            return;
+        }
+        if (slots > kSlotsPerBlock) {
+            if (telemetry) telemetry->recordDeallocation(slots * kSlotSize);
+            releaseSpan(reinterpret_cast<SpanHeader*>(reinterpret_cast<char*>(pointer) - kSpanFirst));
+            return;
+        }
+        BlockHeader* block = blockOf(pointer);
+        uint32_t offset = static_cast<uint32_t>(reinterpret_cast<char*>(pointer) - base(block));
+        uint32_t bytes = static_cast<uint32_t>(slots * kSlotSize);
+        if (offset + bytes == block->bump) {
+            block->bump = offset;
+        } else {
+            for (size_t i = slots; i-- > 0; ) {
+                char* slot = base(block) + offset + i * kSlotSize;
+                *reinterpret_cast<uint32_t*>(slot) = block->free_head;
+                block->free_head = static_cast<uint32_t>(slot - base(block));
+            }
+        }
+        releaseSlots(block, slots);
+        --live_allocations;
+        if (telemetry) telemetry->recordDeallocation(bytes);
+    }
+    
+    // 数组末尾紧挨着所在块的切分位置且块内还有空间时原地扩展到new_count
+    bool tryExtendArray(T* pointer, size_t old_count, size_t new_count) {
+        size_t old_slots = slotsFor(old_count);
+        size_t new_slots = slotsFor(new_count);
+        if (new_slots <= old_slots) return true;
+        if (old_slots > kSlotsPerBlock || new_slots > kSlotsPerBlock) return false;
+        BlockHeader* block = blockOf(pointer);
+        uint32_t offset = static_cast<uint32_t>(reinterpret_cast<char*>(pointer) - base(block));
+        if (offset + old_slots * kSlotSize != block->bump || offset + new_slots * kSlotSize > kBlockEnd) {
+            return false;
+        }
+        block->bump = static_cast<uint32_t>(offset + new_slots * kSlotSize);
+        // 非当前块被扩展到切满时离开部分空闲链表，否则allocateSlow会从块尾之外切分
+        if (block->state == BlockState::Partial && !hasCapacity(block)) {
+            partial_blocks.remove(block);
+            block->state = BlockState::Full;
+        }
+        block->live += static_cast<uint32_t>(new_slots - old_slots);
+        live_objects += new_slots - old_slots;
+        if (telemetry) telemetry->recordGrowth((new_slots - old_slots) * kSlotSize);
+        return true;
+    }
+    
+    // 分配并原地构造；构造函数抛出异常时归还槽位
+    template<typename... Args>
+    T* construct(Args&&... args) {
+        T* pointer = allocate();
+        try {
+            return new (pointer) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(pointer);
+            throw;
+        }
+    }
+    
+    // 析构并归还
+    void destroy(T* pointer) {
+        if (!pointer) return;
+        pointer->~T();
+        deallocate(pointer);
+    }
+    
+    // 一次性丢弃所有对象（不调用析构函数）；大段全部归还，除当前块外的块按保留上限归还系统
+    void reset() {
+        size_t span_slots = 0;
+        for (SpanHeader* span = spans; span; span = span->next) {
+            span_slots += span->slots;
+        }
+        if (telemetry && (live_allocations || span_count)) {
+            telemetry->recordDeallocation((live_objects + span_slots) * kSlotSize, live_allocations + span_count);
+        }
+        while (spans) {
+            releaseSpan(spans);
+        }
+        partial_blocks = List();
+        empty_blocks = List();
+        for (BlockHeader* block = all_blocks; block; ) {
+            BlockHeader* next = block->all_next;
+            if (block != current_block) {
+                retireEmptyBlock(block);
+            }
+            block = next;
+        }
+        resetBlock(current_block);
+        live_objects = 0;
+        live_allocations = 0;
+    }
+    
+    // 保留全空块的上限；降低上限时立即归还多余的块
+    void setMaxEmptyBlocks(size_t count) {
+        max_empty_blocks = count;
+        while (empty_blocks.size > max_empty_blocks) {
+            releaseBlock(empty_blocks.pop());
+        }
+    }
+    
+    // 归还所有保留的全空块
+    void shrink() {
+        while (BlockHeader* block = empty_blocks.pop()) {
+            releaseBlock(block);
+        }
+    }
+    
+    size_t getBlockCount() const { return block_count; }
+    size_t getSpanCount() const { return span_count; }
+    size_t getLiveObjects() const { return live_objects; }
+    size_t getUsedMemory() const { return live_objects * kSlotSize; }
+    static constexpr size_t slotsPerBlock() { return kSlotsPerBlock; }
+    static constexpr size_t slotSize() { return kSlotSize; }
+    const BlockProvider& getProvider() const { return provider; }
+    
+    // 接入遥测（nullptr表示关闭）；不接入时快速路径上只多一次空指针判断
+    void attachTelemetry(AllocationTelemetry* sink) {
+        telemetry = sink;
+        if (telemetry) telemetry->setBlocks(block_count, block_count * BlockSize);
+    }
+};
+
+// 线程缓存的并发内存池（magazine/depot结构）：
+// 每个线程缓存两个magazine（装满对象指针的小数组），分配和释放通常只碰本线程的缓存；
+// 缓存空了或满了时，整只magazine与无锁的中央depot交换；depot也没有时才加锁从
+// HighPerformanceMemoryPool批量切分。对象可以在任何线程释放，它会进入释放线程的缓存
+template<typename T, size_t BlockSize = 4096>
+class ConcurrentMemoryPool {
+private:
+    static constexpr size_t kMagazineSize = 64;
+    // 遥测与HighPerformanceMemoryPool一样按槽位字节记录，两种池的数值可以直接比较
+    static constexpr size_t kSlotBytes = HighPerformanceMemoryPool<T, BlockSize>::slotSize();
+    
+    struct Magazine {
+        std::atomic<Magazine*> next{nullptr};
+        size_t count = 0;
+        T* items[kMagazineSize];
+    };
+    
+    // Treiber栈；x86-64用户态地址只有低48位有效，高16位存版本号防止ABA。
+    // magazine只在池销毁时释放，所以读取已被别人弹出的节点的next是安全的
+    class MagazineStack {
+    private:
+        static_assert(sizeof(void*) == 8, "tagged pointers assume a 64-bit address space");
+        static constexpr uint64_t kPointerMask = (uint64_t(1) << 48) - 1;
+        std::atomic<uint64_t> head{0};
+        
+        static Magazine* pointer(uint64_t value) { return reinterpret_cast<Magazine*>(value & kPointerMask); }
+        static uint64_t pack(Magazine* m, uint64_t tag) {
+            return reinterpret_cast<uint64_t>(m) | ((tag & 0xFFFF) << 48);
+        }
+        
+    public:
+        void push(Magazine* magazine) {
+            uint64_t old_head = head.load(std::memory_order_relaxed);
+            uint64_t new_head;
+            do {
+                magazine->next.store(pointer(old_head), std::memory_order_relaxed);
+                new_head = pack(magazine, (old_head >> 48) + 1);
+            } while (!head.compare_exchange_weak(old_head, new_head, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        }
+        
+        Magazine* pop() {
+            uint64_t old_head = head.load(std::memory_order_acquire);
+            while (Magazine* top = pointer(old_head)) {
+                uint64_t new_head = pack(top->next.load(std::memory_order_relaxed), (old_head >> 48) + 1);
+                if (head.compare_exchange_weak(old_head, new_head, std::memory_order_acquire,
+                                               std::memory_order_acquire)) {
+                    return top;
+                }
+            }
+            return nullptr;
+        }
+    };
+    
+    struct ThreadCache {
+        Magazine* loaded;
+        Magazine* previous;
+    };
+    
+    // 池的全部共享状态；线程退出时通过weak_ptr判断池是否还活着
+    struct SharedState {
+        uint64_t id;
+        MagazineStack full;    // 非空的magazine
+        MagazineStack empty;   // 空magazine
+        std::mutex backing_mutex;
+        HighPerformanceMemoryPool<T, BlockSize> backing;
+        AllocationTelemetry* telemetry = nullptr;
+        std::vector<std::unique_ptr<Magazine>> magazines;
+        
+        explicit SharedState(uint64_t pool_id) : id(pool_id) {}
+        
+        Magazine* newMagazine() {
+            std::lock_guard<std::mutex> lock(backing_mutex);
+            magazines.push_back(std::make_unique<Magazine>());
+            return magazines.back().get();
+        }
+        
+        // depot里没有对象时从后备池切一整只magazine
+        Magazine* refill() {
+            Magazine* magazine = empty.pop();
+            std::lock_guard<std::mutex> lock(backing_mutex);
+            if (!magazine) {
+                magazines.push_back(std::make_unique<Magazine>());
+                magazine = magazines.back().get();
+            }
+            for (size_t i = 0; i < kMagazineSize; ++i) {
+                magazine->items[i] = backing.allocate();
+            }
+            magazine->count = kMagazineSize;
+            if (telemetry) telemetry->setBlocks(backing.getBlockCount(), backing.getBlockCount() * BlockSize);
+            return magazine;
+        }
+        
+        void flush(ThreadCache& cache) {
+            for (Magazine* magazine : {cache.loaded, cache.previous}) {
+                (magazine->count ? full : empty).push(magazine);
+            }
+        }
+    };
+    
+    // 每个线程一份，记录该线程在各个池里的缓存；最近使用的池走快速路径
+    struct ThreadRegistry {
+        struct Entry {
+            uint64_t id;
+            std::weak_ptr<SharedState> state;
+            std::unique_ptr<ThreadCache> cache;
+        };
+        
+        uint64_t last_id = 0;
+        ThreadCache* last_cache = nullptr;
+        std::vector<Entry> entries;
+        
+        ~ThreadRegistry() {
+            for (Entry& entry : entries) {
+                if (auto state = entry.state.lock()) {
+                    state->flush(*entry.cache);
+                }
+            }
+        }
+    };
+    
+    static ThreadRegistry& registry() {
+        thread_local ThreadRegistry local;
+        return local;
+    }
+    
+    static uint64_t nextPoolId() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+    
+    std::shared_ptr<SharedState> state;
+    
+    ThreadCache& cacheSlow() {
+        ThreadRegistry& local = registry();
+        auto found = std::find_if(local.entries.begin(), local.entries.end(),
+                                  [&](const typename ThreadRegistry::Entry& e) { return e.id == state->id; });
+        if (found == local.entries.end()) {
+            // 顺便清理已销毁的池留下的条目
+            local.entries.erase(std::remove_if(local.entries.begin(), local.entries.end(),
+                [](const typename ThreadRegistry::Entry& e) { return e.state.expired(); }),
+                local.entries.end());
+            auto cache = std::make_unique<ThreadCache>();
+            cache->loaded = state->newMagazine();
+            cache->previous = state->newMagazine();
+            local.entries.push_back({state->id, state, std::move(cache)});
+            found = local.entries.end() - 1;
+        }
+        local.last_id = state->id;
+        local.last_cache = found->cache.get();
+        return *local.last_cache;
+    }
+    
+    ThreadCache& cache() {
+        ThreadRegistry& local = registry();
+        if (local.last_id == state->id) {
+            return *local.last_cache;
+        }
+        return cacheSlow();
+    }
+    
+public:
+    ConcurrentMemoryPool() : state(std::make_shared<SharedState>(nextPoolId())) {}
+    
+    ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+    ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+    
+    T* allocate() {
+        ThreadCache& c = cache();
+        if (c.loaded->count == 0) {
+            if (c.previous->count > 0) {
+                std::swap(c.loaded, c.previous);
+            } else {
+                Magazine* full = state->full.pop();
+                if (!full) full = state->refill();
+                state->empty.push(c.previous);
+                c.previous = c.loaded;
+                c.loaded = full;
+            }
+        }
+        if (state->telemetry) state->telemetry->recordAllocation(kSlotBytes);
+        return c.loaded->items[--c.loaded->count];
+    }
+    
+    void deallocate(T* pointer) {
+        if (!pointer) return;
+        ThreadCache& c = cache();
+        if (c.loaded->count == kMagazineSize) {
+            if (c.previous->count < kMagazineSize) {
+                std::swap(c.loaded, c.previous);
+            } else {
+                Magazine* empty = state->empty.pop();
+                if (!empty) empty = state->newMagazine();
+                state->full.push(c.previous);
+                c.previous = c.loaded;
+                c.loaded = empty;
+            }
+        }
+        c.loaded->items[c.loaded->count++] = pointer;
+        if (state->telemetry) state->telemetry->recordDeallocation(kSlotBytes);
+    }
+    
+    template<typename... Args>
+    T* construct(Args&&... args) {
+        T* pointer = allocate();
+        try {
+            return new (pointer) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(pointer);
+            throw;
+        }
+    }
+    
+    void destroy(T* pointer) {
+        if (!pointer) return;
+        pointer->~T();
+        deallocate(pointer);
+    }
+    
+    // 在其他线程开始使用池之前接入；计数器按线程分开，不会引入共享写
+    void attachTelemetry(AllocationTelemetry* sink) {
+        std::lock_guard<std::mutex> lock(state->backing_mutex);
+        state->telemetry = sink;
+        if (sink) sink->setBlocks(state->backing.getBlockCount(), state->backing.getBlockCount() * BlockSize);
+    }
+    
+    // 后备池的块数（只增不减，对象在magazine间循环使用）
+    size_t getBlockCount() {
+        std::lock_guard<std::mutex> lock(state->backing_mutex);
+        return state->backing.getBlockCount();
+    }
+};
+
+// 多尺寸类的slab分配器，以std::pmr::memory_resource的形式提供给标准容器。
+// 每个尺寸类（8..2048字节，2的幂）是一个HighPerformanceMemoryPool，
+// 沿用它的对齐块、块内空闲链表和空块归还；更大或对齐要求更高的请求交给上游资源。
+// Monotonic模式是请求级的arena：只做指针递增，deallocate为空操作，
+// release()把所有块一次性回绕以便下一个请求复用，而不是还给上游
+template<size_t BlockSize = 16384>
+class SlabMemoryResource : public std::pmr::memory_resource {
+public:
+    enum class Mode { Slab, Monotonic };
+    
+private:
+    template<size_t N>
+    struct alignas(N < alignof(std::max_align_t) ? N : alignof(std::max_align_t)) Slot {
+        unsigned char bytes[N];
+    };
+    
+    template<size_t... I>
+    using SlabPools = std::tuple<HighPerformanceMemoryPool<Slot<(size_t(8) << I)>, BlockSize>...>;
+    
+    static constexpr size_t kClassCount = 9;
+    static constexpr size_t kMaxSlabSize = size_t(8) << (kClassCount - 1);
+    static_assert(kMaxSlabSize * 4 <= BlockSize, "BlockSize too small for the largest size class");
+    
+    Mode mode;
+    std::pmr::memory_resource* upstream;
+    SlabPools<0, 1, 2, 3, 4, 5, 6, 7, 8> pools;
+    
+    // Monotonic模式的状态
+    std::vector<void*> arena_blocks;
+    size_t arena_index = 0;
+    size_t arena_offset = 0;
+    struct LargeAllocation { void* pointer; size_t bytes; size_t alignment; };
+    std::vector<LargeAllocation> arena_large;
+    
+    // 尺寸类下标：满足大小和对齐的最小的2的幂
+    static size_t sizeClass(size_t bytes, size_t alignment) {
+        size_t size = std::max({bytes, alignment, size_t(8)});
+        size_t index = 0;
+        while ((size_t(8) << index) < size) ++index;
+        return index;
+    }
+    
+    template<typename Func, size_t... I>
+    static void visitClass(size_t index, Func&& func, std::index_sequence<I...>) {
+        ((index == I ? (func(std::integral_constant<size_t, I>{}), 0) : 0), ...);
+    }
+    
+    template<typename Func>
+    void withPool(size_t index, Func&& func) {
+        visitClass(index, [&](auto I) { func(std::get<decltype(I)::value>(pools)); },
+                   std::make_index_sequence<kClassCount>{});
+    }
+    
+    void* arenaAllocate(size_t bytes, size_t alignment) {
+        if (bytes > BlockSize / 4 || alignment > alignof(std::max_align_t)) {
+            void* pointer = upstream->allocate(bytes, alignment);
+            arena_large.push_back({pointer, bytes, alignment});
+            return pointer;
+        }
+        while (true) {
+            if (arena_index < arena_blocks.size()) {
+                size_t offset = (arena_offset + alignment - 1) & ~(alignment - 1);
+                if (offset + bytes <= BlockSize) {
+                    arena_offset = offset + bytes;
+                    return static_cast<char*>(arena_blocks[arena_index]) + offset;
+                }
+                if (arena_index + 1 < arena_blocks.size()) {
+                    ++arena_index;
+                    arena_offset = 0;
+                    continue;
+                }
+            }
+            arena_blocks.push_back(upstream->allocate(BlockSize, alignof(std::max_align_t)));
+            arena_index = arena_blocks.size() - 1;
+            arena_offset = 0;
+        }
+    }
+    
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (mode == Mode::Monotonic) {
+            return arenaAllocate(bytes, alignment);
+        }
+        if (bytes > kMaxSlabSize || alignment > alignof(std::max_align_t)) {
+            return upstream->allocate(bytes, alignment);
+        }
+        void* pointer = nullptr;
+        withPool(sizeClass(bytes, alignment), [&](auto& pool) { pointer = pool.allocate(); });
+        return pointer;
+    }
+    
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        if (mode == Mode::Monotonic) {
+            return;  // 由release()统一回收
+        }
+        if (bytes > kMaxSlabSize || alignment > alignof(std::max_align_t)) {
+            upstream->deallocate(pointer, bytes, alignment);
+            return;
+        }
+        withPool(sizeClass(bytes, alignment), [&](auto& pool) {
+            using SlotType = std::remove_pointer_t<decltype(pool.allocate())>;
+            pool.deallocate(static_cast<SlotType*>(pointer));
+        });
+    }
+    
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+    
+public:
+    explicit SlabMemoryResource(Mode resource_mode = Mode::Slab,
+                                std::pmr::memory_resource* upstream_resource = std::pmr::new_delete_resource())
+        : mode(resource_mode), upstream(upstream_resource) {}
+    
+    ~SlabMemoryResource() override {
+        release();
+        for (void* block : arena_blocks) {
+            upstream->deallocate(block, BlockSize, alignof(std::max_align_t));
+        }
+    }
+    
+    SlabMemoryResource(const SlabMemoryResource&) = delete;
+    SlabMemoryResource& operator=(const SlabMemoryResource&) = delete;
+    
+    // Monotonic模式：结束一个请求，块留作下次使用；Slab模式下无操作
+    void release() {
+        for (const LargeAllocation& large : arena_large) {
+            upstream->deallocate(large.pointer, large.bytes, large.alignment);
+        }
+        arena_large.clear();
+        arena_index = 0;
+        arena_offset = 0;
+    }
+    
+    Mode getMode() const { return mode; }
+    
+    size_t getBlockCount() {
+        size_t blocks = arena_blocks.size();
+        for (size_t i = 0; i < kClassCount; ++i) {
+            withPool(i, [&](auto& pool) { blocks += pool.getBlockCount(); });
+        }
+        return blocks;
+    }
+};
+
+// 使用内存池的高性能容器：元素存放在池里的连续槽位中。
+// 增长时先尝试在池的切分位置原地扩展，不行才重新分配并搬移元素，旧缓冲区归还给池
+template<typename T, size_t BlockSize = 4096, typename BlockProvider = HeapBlockProvider>
+class PooledVector {
+private:
+    HighPerformanceMemoryPool<T, BlockSize, BlockProvider>& pool;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    
+    // 把元素搬到新缓冲区：可平凡复制的直接memcpy，否则移动构造
+    // （移动可能抛异常且可复制时退回复制，保证强异常安全）
+    static void relocate(T* source, size_t count, T* destination) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (count) std::memcpy(static_cast<void*>(destination), source, count * sizeof(T));
+        } else {
+            size_t constructed = 0;
+            try {
+                for (; constructed < count; ++constructed) {
+                    new (destination + constructed) T(std::move_if_noexcept(source[constructed]));
+                }
+            } catch (...) {
+                std::destroy_n(destination, constructed);
+                throw;
+            }
+            std::destroy_n(source, count);
+        }
+    }
+    
+    void grow() {
+        reserve(capacity_ == 0 ? 4 : capacity_ * 2);
+    }
+    
+public:
+    explicit PooledVector(HighPerformanceMemoryPool<T, BlockSize, BlockProvider>& p) : pool(p) {}
+    
+    ~PooledVector() {
+        clear();
+        pool.deallocateArray(data_, capacity_);
+    }
+    
+    PooledVector(const PooledVector&) = delete;
+    PooledVector& operator=(const PooledVector&) = delete;
+    
+    PooledVector(PooledVector&& other) noexcept
+        : pool(other.pool), data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+    
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+    
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+    
+    template<typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (size_ == capacity_) {
+            if (capacity_ && pool.tryExtendArray(data_, capacity_, capacity_ * 2)) {
+                capacity_ *= 2;  // 原地扩展，元素不动
+            } else {
+                // 参数可能引用自身元素，先构造出临时对象再搬移
+                T value(std::forward<Args>(args)...);
+                grow();
+                T* element = new (data_ + size_) T(std::move(value));
+                ++size_;
+                return *element;
+            }
+        }
+        T* element = new (data_ + size_) T(std::forward<Args>(args)...);
+        ++size_;
+        return *element;
+    }
+    
+    void pop_back() {
+        data_[--size_].~T();
+    }
+    
+    void reserve(size_t new_capacity) {
+        if (new_capacity <= capacity_) return;
+        if (data_ && pool.tryExtendArray(data_, capacity_, new_capacity)) {
+            capacity_ = new_capacity;
+            return;
+        }
+        T* new_data = pool.allocateArray(new_capacity);
+        try {
+            relocate(data_, size_, new_data);
+        } catch (...) {
+            pool.deallocateArray(new_data, new_capacity);
+            throw;
+        }
+        pool.deallocateArray(data_, capacity_);
+        data_ = new_data;
+        capacity_ = new_capacity;
+    }
+    
+    void clear() {
+        std::destroy_n(data_, size_);
+        size_ = 0;
+    }
+    
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    T& operator[](size_t index) { return data_[index]; }
+    const T& operator[](size_t index) const { return data_[index]; }
+};
+
+// 长时间运行的分配模式：随机交错的分配/释放，每100万次操作在"增长"和"收缩"阶段间切换
+struct ChurnObject {
+    uint64_t id;
+    uint64_t payload[3];
+    
+    explicit ChurnObject(uint64_t value) : id(value), payload{value, value, value} {}
+};
+
+template<typename Allocate, typename Free>
+uint64_t runChurnWorkload(size_t operations, size_t max_live, Allocate&& allocate, Free&& release) {
+    std::vector<ChurnObject*> live;
+    live.reserve(max_live);
+    uint64_t state = 0x9E3779B97F4A7C15ull;  // 固定种子的xorshift64，两种分配器看到相同的序列
+    uint64_t checksum = 0;
+    for (size_t op = 0; op < operations; ++op) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        unsigned alloc_quarters = (op / 1000000) % 2 == 0 ? 3 : 1;  // 增长阶段75%分配，收缩阶段25%
+        bool do_alloc = live.empty() || (live.size() < max_live && (state & 3) < alloc_quarters);
+        if (do_alloc) {
+            live.push_back(allocate(state));
+        } else {
+            size_t index = (state >> 2) % live.size();
+            checksum += live[index]->id;
+            release(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+    for (ChurnObject* object : live) {
+        checksum += object->id;
+        release(object);
+    }
+    return checksum;
+}
+
+void testMemoryPoolChurn() {
+    const size_t operations = 10000000;
+    const size_t max_live = 200000;
+    std::cout << "\nChurn workload: " << operations << " random alloc/free operations\n";
+    
+    uint64_t expected = 0;
+    benchmarkFunction("Churn new/delete", [&]() {
+        expected = runChurnWorkload(operations, max_live,
+            [](uint64_t v) { return new ChurnObject(v); },
+            [](ChurnObject* p) { delete p; });
+    }, 3);
+    
+    HighPerformanceMemoryPool<ChurnObject> pool;
+    size_t peak_blocks = 0;
+    benchmarkFunction("Churn Memory Pool", [&]() {
+        uint64_t checksum = runChurnWorkload(operations, max_live,
+            [&](uint64_t v) {
+                ChurnObject* p = pool.construct(v);
+                peak_blocks = std::max(peak_blocks, pool.getBlockCount());
+                return p;
+            },
+            [&](ChurnObject* p) { pool.destroy(p); });
+        if (checksum != expected) {
+            throw std::runtime_error("pool churn checksum mismatch");
+        }
+    }, 3);
+    
+    std::cout << "Pool blocks: peak " << peak_blocks << ", after churn " << pool.getBlockCount()
+              << " (" << pool.getLiveObjects() << " live objects, "
+              << HighPerformanceMemoryPool<ChurnObject>::slotsPerBlock() << " slots per block)\n";
+    pool.shrink();
+    std::cout << "Pool blocks after shrink: " << pool.getBlockCount() << std::endl;
+    if (pool.getLiveObjects() != 0 || pool.getBlockCount() != 1) {
+        throw std::runtime_error("pool did not return empty blocks");
+    }
+}
+
+// 单生产者单消费者环形队列，用于在线程间传递待释放的对象
+template<typename T, size_t Capacity = 1024>
+class SpscRing {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    alignas(64) std::atomic<size_t> head{0};  // 消费者位置
+    alignas(64) std::atomic<size_t> tail{0};  // 生产者位置
+    alignas(64) T items[Capacity];
+    
+public:
+    bool push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// 生产者/消费者分配基准：每对线程中生产者分配并交给消费者释放（跨线程释放）；
+// 单线程时同一线程分配一批再释放
+template<typename Allocate, typename Free>
+void runProducerConsumer(size_t threads, size_t objects_per_pair, Allocate&& allocate, Free&& release) {
+    if (threads < 2) {
+        std::vector<ChurnObject*> batch(256);
+        for (size_t done = 0; done < objects_per_pair; done += batch.size()) {
+            for (auto& object : batch) object = allocate(done);
+            for (auto* object : batch) release(object);
+        }
+        return;
+    }
+    size_t pairs = threads / 2;
+    std::vector<std::unique_ptr<SpscRing<ChurnObject*>>> rings;
+    for (size_t p = 0; p < pairs; ++p) {
+        rings.push_back(std::make_unique<SpscRing<ChurnObject*>>());
+    }
+    std::vector<std::thread> workers;
+    for (size_t p = 0; p < pairs; ++p) {
+        SpscRing<ChurnObject*>& ring = *rings[p];
+        workers.emplace_back([&, p]() {
+            for (size_t i = 0; i < objects_per_pair; ++i) {
+                ChurnObject* object = allocate(p * objects_per_pair + i);
+                while (!ring.push(object)) std::this_thread::yield();
+            }
+        });
+        workers.emplace_back([&]() {
+            ChurnObject* object;
+            for (size_t i = 0; i < objects_per_pair; ++i) {
+                while (!ring.pop(object)) std::this_thread::yield();
+                release(object);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void testConcurrentMemoryPool() {
+    std::cout << "\n=== Concurrent Memory Pool Test ===\n";
+    TRACE_SCOPE("testConcurrentMemoryPool");
+    
+    std::vector<size_t> thread_counts = {1, 2, 4, 8};
+    size_t max_threads = benchmarkConfig().full_sizes ? 64 : std::min<size_t>(64, 2 * std::thread::hardware_concurrency());
+    for (size_t t = 16; t <= max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    const size_t total_objects = 2000000;
+    
+    for (size_t threads : thread_counts) {
+        size_t pairs = std::max<size_t>(1, threads / 2);
+        size_t per_pair = total_objects / pairs;
+        std::string suffix = " threads=" + std::to_string(threads);
+        
+        benchmarkFunction("Producer/Consumer malloc" + suffix, [&]() {
+            runProducerConsumer(threads, per_pair,
+                [](size_t v) { return new ChurnObject(v); },
+                [](ChurnObject* p) { delete p; });
+        }, 3);
+        
+        HighPerformanceMemoryPool<ChurnObject> locked_pool;
+        std::mutex pool_mutex;
+        benchmarkFunction("Producer/Consumer mutex pool" + suffix, [&]() {
+            runProducerConsumer(threads, per_pair,
+                [&](size_t v) {
+                    std::lock_guard<std::mutex> lock(pool_mutex);
+                    return locked_pool.construct(v);
+                },
+                [&](ChurnObject* p) {
+                    std::lock_guard<std::mutex> lock(pool_mutex);
+                    locked_pool.destroy(p);
+                });
+        }, 3);
+        
+        ConcurrentMemoryPool<ChurnObject> concurrent_pool;
+        benchmarkFunction("Producer/Consumer concurrent pool" + suffix, [&]() {
+            runProducerConsumer(threads, per_pair,
+                [&](size_t v) { return concurrent_pool.construct(v); },
+                [&](ChurnObject* p) { concurrent_pool.destroy(p); });
+        }, 3);
+    }
+}
+
+// PooledVector与std::vector的push_back密集负载对比
+void testPooledVector() {
+    std::cout << "\n=== Pooled Vector Test ===\n";
+    TRACE_SCOPE("testPooledVector");
+    
+    // 正确性：非平凡类型的搬移、原地扩展和缓冲区回收
+    {
+        HighPerformanceMemoryPool<std::string> pool;
+        bool ok = true;
+        {
+            PooledVector<std::string> strings(pool);
+            for (int i = 0; i < 5000; ++i) {
+                strings.push_back("element number " + std::to_string(i));
+                strings.emplace_back(strings[i / 2]);  // 引用自身元素
+            }
+            for (int i = 0; i < 5000; ++i) {
+                ok = ok && strings[2 * i] == "element number " + std::to_string(i)
+                        && strings[2 * i + 1] == strings[i / 2];
+            }
+        }
+        ok = ok && pool.getLiveObjects() == 0;
+        std::cout << "PooledVector check: " << (ok ? "OK" : "FAILED") << "\n";
+    }
+    
+    // 回归：数组所在的块被换下（进入部分空闲链表）后再原地扩展到块尾，
+    // 之后的分配不能从这个块的末尾之外切出槽位（槽位永远不会落在块首的块头上）
+    {
+        HighPerformanceMemoryPool<int> pool;
+        const size_t full = HighPerformanceMemoryPool<int>::slotsPerBlock();
+        int* first = pool.allocateArray(full / 2);
+        int* second = pool.allocateArray(full / 2 + 100);  // 放不下，first所在块被换下
+        bool ok = pool.tryExtendArray(first, full / 2, full);
+        for (size_t i = 0; i < full; ++i) first[i] = static_cast<int>(i);
+        std::vector<int*> singles;
+        for (size_t i = 0; i < 2 * full; ++i) {
+            int* p = pool.allocate();
+            ok = ok && reinterpret_cast<uintptr_t>(p) % 4096 != 0;
+            *p = -1;
+            singles.push_back(p);
+        }
+        for (size_t i = 0; i < full; ++i) ok = ok && first[i] == static_cast<int>(i);
+        for (int* p : singles) pool.deallocate(p);
+        pool.deallocateArray(second, full / 2 + 100);
+        pool.deallocateArray(first, full);
+        ok = ok && pool.getLiveObjects() == 0;
+        std::cout << "Extend non-current block check: " << (ok ? "OK" : "FAILED") << "\n";
+    }
+    
+    const size_t large_size = size_t(1) << 20;
+    benchmarkFunction("std::vector push_back 1M", [&]() {
+        std::vector<int> values;
+        for (size_t i = 0; i < large_size; ++i) values.push_back(static_cast<int>(i));
+        volatile int result = values.back();
+    }, 10);
+    
+    // 块足够大时整个数组都在一个块内原地扩展，析构时切分位置直接回退
+    HighPerformanceMemoryPool<int, (size_t(1) << 23)> large_pool;
+    benchmarkFunction("PooledVector push_back 1M", [&]() {
+        PooledVector<int, (size_t(1) << 23)> values(large_pool);
+        for (size_t i = 0; i < large_size; ++i) values.push_back(static_cast<int>(i));
+        volatile int result = values[large_size - 1];
+    }, 10);
+    
+    const size_t vector_count = 10000;
+    const size_t elements = 100;
+    benchmarkFunction("std::vector 10k small vectors", [&]() {
+        std::vector<std::vector<int>> vectors(vector_count);
+        for (auto& v : vectors) {
+            for (size_t i = 0; i < elements; ++i) v.push_back(static_cast<int>(i));
+        }
+        volatile int result = vectors.back().back();
+    }, 10);
+    
+    HighPerformanceMemoryPool<int, 65536> small_pool;
+    benchmarkFunction("PooledVector 10k small vectors", [&]() {
+        std::vector<PooledVector<int, 65536>> vectors;
+        vectors.reserve(vector_count);
+        for (size_t n = 0; n < vector_count; ++n) {
+            PooledVector<int, 65536>& v = vectors.emplace_back(small_pool);
+            for (size_t i = 0; i < elements; ++i) v.push_back(static_cast<int>(i));
+        }
+        volatile int result = vectors.back()[elements - 1];
+    }, 10);
+    
+    // 交错增长：没有原地扩展的机会，考察旧缓冲区回收
+    const size_t interleaved = 1000;
+    benchmarkFunction("std::vector interleaved growth", [&]() {
+        std::vector<std::vector<int>> vectors(interleaved);
+        for (size_t i = 0; i < elements; ++i) {
+            for (auto& v : vectors) v.push_back(static_cast<int>(i));
+        }
+        volatile int result = vectors.back().back();
+    }, 10);
+    
+    benchmarkFunction("PooledVector interleaved growth", [&]() {
+        std::vector<PooledVector<int, 65536>> vectors;
+        vectors.reserve(interleaved);
+        for (size_t n = 0; n < interleaved; ++n) vectors.emplace_back(small_pool);
+        for (size_t i = 0; i < elements; ++i) {
+            for (auto& v : vectors) v.push_back(static_cast<int>(i));
+        }
+        volatile int result = vectors.back()[elements - 1];
+    }, 10);
+    std::cout << "Pool blocks after benchmarks: " << small_pool.getBlockCount()
+              << " (live slots: " << small_pool.getLiveObjects() << ")\n";
+}
+
+// 块来源对TLB的影响：大池子上的随机指针追逐，4 KiB堆块 vs mmap块 vs 2 MiB大页块
+template<typename Pool>
+void benchmarkBlockProvider(const std::string& label, size_t object_count) {
+    benchmarkFunction("Pool allocate [" + label + "]", [&]() {
+        Pool pool;
+        for (size_t i = 0; i < object_count; ++i) {
+            pool.construct(i);
+        }
+        volatile size_t blocks = pool.getBlockCount();
+    }, 3);
+    
+    Pool pool;
+    std::vector<ChurnObject*> objects(object_count);
+    for (size_t i = 0; i < object_count; ++i) {
+        objects[i] = pool.construct(i);
+    }
+    // 随机环：payload[0]存下一个对象的地址，每次访问都依赖上一次的加载
+    Xoshiro256 rng = Workload::rng(42);
+    std::vector<ChurnObject*> order(objects);
+    Workload::shuffle(order, rng);
+    for (size_t i = 0; i < object_count; ++i) {
+        order[i]->payload[0] = reinterpret_cast<uint64_t>(order[(i + 1) % object_count]);
+    }
+    const size_t steps = std::min<size_t>(object_count, size_t(1) << 20);
+    benchmarkFunction("Pool pointer chase [" + label + "]", [&]() {
+        const ChurnObject* current = order[0];
+        uint64_t sum = 0;
+        for (size_t i = 0; i < steps; ++i) {
+            sum += current->id;
+            current = reinterpret_cast<const ChurnObject*>(current->payload[0]);
+        }
+        volatile uint64_t result = sum;
+    }, 3);
+    std::cout << "  " << label << ": " << pool.getBlockCount() << " blocks from "
+              << pool.getProvider().describe() << "\n";
+}
+
+void testHugePageBlocks() {
+    std::cout << "\n=== Block Provider Test ===\n";
+    TRACE_SCOPE("testHugePageBlocks");
+    
+    const size_t object_count = benchmarkConfig().full_sizes ? (size_t(16) << 20) : (size_t(2) << 20);
+    constexpr size_t kHugeBlock = size_t(2) << 20;
+    benchmarkBlockProvider<HighPerformanceMemoryPool<ChurnObject, 4096, HeapBlockProvider>>(
+        "heap 4 KiB", object_count);
+    benchmarkBlockProvider<HighPerformanceMemoryPool<ChurnObject, 4096, MmapBlockProvider>>(
+        "mmap 4 KiB", object_count);
+    benchmarkBlockProvider<HighPerformanceMemoryPool<ChurnObject, kHugeBlock, MmapBlockProvider>>(
+        "mmap 2 MiB", object_count);
+    
+    // 超过一个块的数组也从块来源获得：4 KiB块的池里分配一个16 MiB的数组
+    HighPerformanceMemoryPool<int, 4096, MmapBlockProvider> pool;
+    const size_t count = size_t(4) << 20;
+    int* array = pool.allocateArray(count);
+    for (size_t i = 0; i < count; ++i) array[i] = static_cast<int>(i);
+    bool ok = true;
+    for (size_t i = 0; i < count; i += 4099) ok = ok && array[i] == static_cast<int>(i);
+    pool.deallocateArray(array, count);
+    ok = ok && pool.getSpanCount() == 0;
+    // 未归还的大段由reset一起释放
+    pool.allocateArray(count);
+    pool.allocateArray(count / 2);
+    ok = ok && pool.getSpanCount() == 2;
+    pool.reset();
+    ok = ok && pool.getSpanCount() == 0;
+    std::cout << "Oversized array from provider check: " << (ok ? "OK" : "FAILED") << "\n";
+}
+
+// 遥测开销与快照：同一负载在接入/不接入遥测的池上各跑一遍，再打印各分配器的快照
+void testAllocationTelemetry() {
+    std::cout << "\n=== Allocation Telemetry Test ===\n";
+    TRACE_SCOPE("testAllocationTelemetry");
+    
+    // reset按对象个数记录释放：3个单对象、1个块内数组和1个超过块容量的数组是5次释放，使用中字节归零
+    {
+        AllocationTelemetry reset_telemetry("reset check");
+        HighPerformanceMemoryPool<int> small_pool;
+        small_pool.attachTelemetry(&reset_telemetry);
+        for (int i = 0; i < 3; ++i) small_pool.allocate();
+        small_pool.allocateArray(10);
+        small_pool.allocateArray(5000);
+        small_pool.reset();
+        TelemetrySnapshot snapshot = reset_telemetry.snapshot();
+        bool ok = snapshot.allocations == 5 && snapshot.deallocations == 5 && snapshot.bytes_in_use == 0 &&
+                  small_pool.getSpanCount() == 0;
+        std::cout << "Telemetry reset check: " << (ok ? "OK" : "FAILED") << "\n";
+    }
+    
+    const size_t operations = 2000000;
+    const size_t max_live = 100000;
+    
+    HighPerformanceMemoryPool<ChurnObject> plain_pool;
+    benchmarkFunction("Churn pool without telemetry", [&]() {
+        runChurnWorkload(operations, max_live,
+            [&](uint64_t v) { return plain_pool.construct(v); },
+            [&](ChurnObject* p) { plain_pool.destroy(p); });
+    }, 3);
+    
+    AllocationTelemetry pool_telemetry("HighPerformanceMemoryPool<ChurnObject>");
+    HighPerformanceMemoryPool<ChurnObject> pool;
+    pool.attachTelemetry(&pool_telemetry);
+    benchmarkFunction("Churn pool with telemetry", [&]() {
+        runChurnWorkload(operations, max_live,
+            [&](uint64_t v) { return pool.construct(v); },
+            [&](ChurnObject* p) { pool.destroy(p); });
+    }, 3);
+    
+    // 并发池：生产者分配、消费者释放，各线程的计数器在快照时汇总
+    AllocationTelemetry concurrent_telemetry("ConcurrentMemoryPool<ChurnObject>");
+    ConcurrentMemoryPool<ChurnObject> concurrent_pool;
+    concurrent_pool.attachTelemetry(&concurrent_telemetry);
+    runProducerConsumer(4, 200000,
+        [&](size_t v) { return concurrent_pool.construct(v); },
+        [&](ChurnObject* p) { concurrent_pool.destroy(p); });
+    std::vector<ChurnObject*> kept;
+    for (size_t i = 0; i < 10000; ++i) {
+        kept.push_back(concurrent_pool.construct(i));
+    }
+    
+    // 数组分配让尺寸直方图有不同的桶
+    AllocationTelemetry vector_telemetry("PooledVector<int>");
+    HighPerformanceMemoryPool<int, 65536> int_pool;
+    int_pool.attachTelemetry(&vector_telemetry);
+    std::vector<PooledVector<int, 65536>> vectors;
+    vectors.reserve(200);
+    for (size_t n = 0; n < 200; ++n) {
+        PooledVector<int, 65536>& v = vectors.emplace_back(int_pool);
+        for (size_t i = 0; i < n * n / 4; ++i) v.push_back(static_cast<int>(i));
+    }
+    
+    AllocationTelemetry::printAll(std::cout);
+    if (!benchmarkConfig().telemetry_path.empty()) {
+        AllocationTelemetry::writeJSON(benchmarkConfig().telemetry_path);
+    }
+    
+    for (ChurnObject* object : kept) {
+        concurrent_pool.destroy(object);
+    }
+}
+
+// 测试内存池性能
+void testMemoryPool() {
+    std::cout << "\n=== Memory Pool Performance Test ===\n";
+    TRACE_SCOPE("testMemoryPool");
+    
+    const size_t num_allocations = 100000;
+    
+    // 测试标准分配器
+    benchmarkFunction("Standard Allocator", [&]() {
+        std::vector<int*> ptrs;
+        ptrs.reserve(num_allocations);
+        
+        for (size_t i = 0; i < num_allocations; ++i) {
+            ptrs.push_back(new int(i));
+        }
+        
+        for (auto ptr : ptrs) {
+            delete ptr;
+        }
+    }, 10);
+    
+    // 测试内存池
+    benchmarkFunction("Memory Pool", [&]() {
+        HighPerformanceMemoryPool<int> pool;
+        std::vector<int*> ptrs;
+        ptrs.reserve(num_allocations);
+        
+        for (size_t i = 0; i < num_allocations; ++i) {
+            int* ptr = pool.allocate();
+            *ptr = i;
+            ptrs.push_back(ptr);
+        }
+        
+        pool.reset();  // 快速释放所有内存
+    }, 10);
+    
+    testMemoryPoolChurn();
+    testPooledVector();
+    testHugePageBlocks();
+    testConcurrentMemoryPool();
+    testAllocationTelemetry();
+}
+
+// =============================================================================
+// 3. SIMD优化示例
+// =============================================================================
+
+class SIMDOptimization {
+public:
+    // 每个指令集一组内核，启动时选定一组，之后的调用只是一次间接调用
+    struct KernelTable {
+        SimdLevel level;
+        double (*sum)(const float*, size_t);
+        void (*add)(const float*, const float*, float*, size_t);
+    };
+    
+    // 标量版本：数组求和
+    static double sumArrayScalar(const float* arr, size_t size) {
+        double sum = 0.0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += arr[i];
+        }
+        return sum;
+    }
+    
+    // SSE2版本：数组求和（4路）
+    __attribute__((target("sse2")))
+    static double sumArraySSE2(const float* arr, size_t size) {
+        __m128 sum_vec = _mm_setzero_ps();
+        size_t simd_size = size - (size % 4);
+        
+        for (size_t i = 0; i < simd_size; i += 4) {
+            sum_vec = _mm_add_ps(sum_vec, _mm_loadu_ps(&arr[i]));
+        }
+        
+        // 水平求和（SSE2没有hadd，用shuffle）
+        __m128 shuffled = _mm_shuffle_ps(sum_vec, sum_vec, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(sum_vec, shuffled);
+        shuffled = _mm_movehl_ps(shuffled, sums);
+        sums = _mm_add_ss(sums, shuffled);
+        
+        double result = _mm_cvtss_f32(sums);
+        for (size_t i = simd_size; i < size; ++i) {
+            result += arr[i];
+        }
+        return result;
+    }
+    
+    // AVX2版本：数组求和（8路）
+    __attribute__((target("avx2")))
+    static double sumArrayAVX2(const float* arr, size_t size) {
+        __m256 sum_vec = _mm256_setzero_ps();
+        size_t simd_size = size - (size % 8);
+        
+        // SIMD处理
+        for (size_t i = 0; i < simd_size; i += 8) {
+            __m256 data = _mm256_loadu_ps(&arr[i]);
+            sum_vec = _mm256_add_ps(sum_vec, data);
+        }
+        
+        // 水平求和
+        __m128 sum_high = _mm256_extractf128_ps(sum_vec, 1);
+        __m128 sum_low = _mm256_castps256_ps128(sum_vec);
+        __m128 sum_final = _mm_add_ps(sum_high, sum_low);
+        
+        sum_final = _mm_hadd_ps(sum_final, sum_final);
+        sum_final = _mm_hadd_ps(sum_final, sum_final);
+        
+        double result = _mm_cvtss_f32(sum_final);
+        
+        // 处理剩余元素
+        for (size_t i = simd_size; i < size; ++i) {
+            result += arr[i];
+        }
+        
+        return result;
+    }
+    
+    // AVX-512版本：数组求和（16路，尾部用掩码加载）
+    __attribute__((target("avx512f")))
+    static double sumArrayAVX512(const float* arr, size_t size) {
+        __m512 sum_vec = _mm512_setzero_ps();
+        size_t simd_size = size - (size % 16);
+        
+        for (size_t i = 0; i < simd_size; i += 16) {
+            sum_vec = _mm512_add_ps(sum_vec, _mm512_loadu_ps(&arr[i]));
+        }
+        __mmask16 tail = static_cast<__mmask16>((1u << (size % 16)) - 1);
+        sum_vec = _mm512_add_ps(sum_vec, _mm512_maskz_loadu_ps(tail, &arr[simd_size]));
+        
+        // 水平求和：存回16个通道再相加
+        alignas(64) float lanes[16];
+        _mm512_store_ps(lanes, sum_vec);
+        double result = 0.0;
+        for (float lane : lanes) {
+            result += lane;
+        }
+        return result;
+    }
+    
+    // 按当前选定的指令集求和
+    static double sumArraySIMD(const float* arr, size_t size) {
+        return kernels.sum(arr, size);
+    }
+    
+    // 向量加法 - 标量版本
+    static void addArraysScalar(const float* a, const float* b, float* result, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            result[i] = a[i] + b[i];
+        }
+    }
+    
+    // 向量加法 - SSE2版本
+    __attribute__((target("sse2")))
+    static void addArraysSSE2(const float* a, const float* b, float* result, size_t size) {
+        size_t simd_size = size - (size % 4);
+        
+        for (size_t i = 0; i < simd_size; i += 4) {
+            _mm_storeu_ps(&result[i], _mm_add_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+        }
+        
+        for (size_t i = simd_size; i < size; ++i) {
+            result[i] = a[i] + b[i];
+        }
+    }
+    
+    // 向量加法 - AVX2版本
+    __attribute__((target("avx2")))
+    static void addArraysAVX2(const float* a, const float* b, float* result, size_t size) {
+        size_t simd_size = size - (size % 8);
+        
+        for (size_t i = 0; i < simd_size; i += 8) {
+            __m256 va = _mm256_loadu_ps(&a[i]);
+            __m256 vb = _mm256_loadu_ps(&b[i]);
+            __m256 vresult = _mm256_add_ps(va, vb);
+            _mm256_storeu_ps(&result[i], vresult);
+        }
+        
+        // 处理剩余元素
+        for (size_t i = simd_size; i < size; ++i) {
+            result[i] = a[i] + b[i];
+        }
+    }
+    
+    // 向量加法 - AVX-512版本（尾部用掩码读写，不需要标量循环）
+    __attribute__((target("avx512f")))
+    static void addArraysAVX512(const float* a, const float* b, float* result, size_t size) {
+        size_t simd_size = size - (size % 16);
+        
+        for (size_t i = 0; i < simd_size; i += 16) {
+            _mm512_storeu_ps(&result[i], _mm512_add_ps(_mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&b[i])));
+        }
+        __mmask16 tail = static_cast<__mmask16>((1u << (size % 16)) - 1);
+        __m512 va = _mm512_maskz_loadu_ps(tail, &a[simd_size]);
+        __m512 vb = _mm512_maskz_loadu_ps(tail, &b[simd_size]);
+        _mm512_mask_storeu_ps(&result[simd_size], tail, _mm512_add_ps(va, vb));
+    }
+    
+    // 按当前选定的指令集相加
+    static void addArraysSIMD(const float* a, const float* b, float* result, size_t size) {
+        kernels.add(a, b, result, size);
+    }
+    
+    // 多线程版本：低于阈值时直接走单线程内核，避免唤醒线程池的开销超过收益
+    static constexpr size_t kParallelThreshold = size_t(1) << 22;
+    // 每块64K个元素（256KB）；分块只取决于数组长度和首地址，与线程数无关
+    static constexpr size_t kParallelChunk = size_t(1) << 16;
+    
+    // 块边界落在缓存行上：第一块多带上首地址到下一条缓存行之间的元素，相邻线程不会写同一条缓存行
+    static size_t parallelChunkHead(const void* base) {
+        size_t misalignment = reinterpret_cast<uintptr_t>(base) % 64 / sizeof(float);
+        return misalignment == 0 ? 0 : 64 / sizeof(float) - misalignment;
+    }
+    
+    static size_t parallelChunkBegin(const void* base, size_t chunk, size_t size) {
+        if (chunk == 0) return 0;
+        return std::min(size, parallelChunkHead(base) + chunk * kParallelChunk);
+    }
+    
+    static size_t parallelChunkCount(const void* base, size_t size) {
+        size_t head = parallelChunkHead(base);
+        if (size <= head + kParallelChunk) return 1;
+        return (size - head + kParallelChunk - 1) / kParallelChunk;
+    }
+    
+    // 每块的部分和写入各自的槽位，最后按块序号顺序合并：
+    // 同一输入在任意线程数下结果逐位相同（与单线程sumArraySIMD可能有末位差异）
+    static float sumArrayParallel(const float* data, size_t size, size_t max_threads = 0) {
+        if (size < kParallelThreshold) {
+            return sumArraySIMD(data, size);
+        }
+        size_t chunks = parallelChunkCount(data, size);
+        std::vector<float> partials(chunks);
+        WorkStealingPool::instance().parallelFor(chunks, [&](size_t chunk) {
+            size_t begin = parallelChunkBegin(data, chunk, size);
+            size_t end = parallelChunkBegin(data, chunk + 1, size);
+            partials[chunk] = kernels.sum(data + begin, end - begin);
+        }, max_threads);
+        double total = 0.0;
+        for (float partial : partials) total += partial;
+        return static_cast<float>(total);
+    }
+    
+    // 按result的地址分块，保证各线程写入的区域不共享缓存行
+    static void addArraysParallel(const float* a, const float* b, float* result, size_t size,
+                                  size_t max_threads = 0) {
+        if (size < kParallelThreshold) {
+            addArraysSIMD(a, b, result, size);
+            return;
+        }
+        WorkStealingPool::instance().parallelFor(parallelChunkCount(result, size), [&](size_t chunk) {
+            size_t begin = parallelChunkBegin(result, chunk, size);
+            size_t end = parallelChunkBegin(result, chunk + 1, size);
+            kernels.add(a + begin, b + begin, result + begin, end - begin);
+        }, max_threads);
+    }
+    
+    static KernelTable kernelsFor(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX512: return {level, sumArrayAVX512, addArraysAVX512};
+            case SimdLevel::AVX2: return {level, sumArrayAVX2, addArraysAVX2};
+            case SimdLevel::SSE2: return {level, sumArraySSE2, addArraysSSE2};
+            case SimdLevel::Scalar: break;
+        }
+        return {SimdLevel::Scalar, sumArrayScalar, addArraysScalar};
+    }
+    
+    // 切换当前使用的内核（--isa=强制指令集时调用）
+    static void selectKernels(SimdLevel level) {
+        kernels = kernelsFor(level);
+    }
+    
+    static SimdLevel activeLevel() { return kernels.level; }
+    
+    // 测试SIMD优化效果
+    static void testSIMDOptimization() {
+        std::cout << "\n=== SIMD Optimization Test ===\n";
+        TRACE_SCOPE("SIMDOptimization::testSIMDOptimization");
+        
+        const size_t size = 1000000;
+        
+        // 初始化数据
+        std::vector<float> a = Workload::generate<float>({Distribution::Uniform, size, -100.0, 100.0, 1});
+        std::vector<float> b = Workload::generate<float>({Distribution::Uniform, size, -100.0, 100.0, 2});
+        std::vector<float> result1(size), result2(size);
+        
+        // 测试数组求和
+        benchmarkFunction("Array Sum Scalar", [&]() {
+            volatile double sum = sumArrayScalar(a.data(), size);
+        }, 100);
+        
+        benchmarkFunction("Array Sum SIMD", [&]() {
+            volatile double sum = sumArraySIMD(a.data(), size);
+        }, 100);
+        
+        // 测试向量加法
+        benchmarkFunction("Array Add Scalar", [&]() {
+            addArraysScalar(a.data(), b.data(), result1.data(), size);
+        }, 100);
+        
+        benchmarkFunction("Array Add SIMD", [&]() {
+            addArraysSIMD(a.data(), b.data(), result2.data(), size);
+        }, 100);
+        
+        // 验证结果正确性
+        bool results_match = std::equal(result1.begin(), result1.end(), result2.begin(),
+            [](float a, float b) { return std::abs(a - b) < 1e-6f; });
+        std::cout << "Results match: " << (results_match ? "Yes" : "No") << std::endl;
+        
+        // 逐个测试不高于当前选定级别的每个指令集版本；长度取非整倍数以覆盖尾部处理
+        CpuFeatures& cpu = CpuFeatures::instance();
+        std::cout << "SIMD kernels: " << CpuFeatures::name(activeLevel()) << " (detected "
+                  << CpuFeatures::name(cpu.detectedLevel()) << ")\n";
+        const size_t odd_size = size - 5;
+        double reference = sumArrayScalar(a.data(), odd_size);
+        addArraysScalar(a.data(), b.data(), result1.data(), odd_size);
+        for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (level > cpu.level()) continue;
+            KernelTable table = kernelsFor(level);
+            std::string suffix = std::string(" [") + CpuFeatures::name(level) + "]";
+            benchmarkFunction("Array Sum" + suffix, [&]() {
+                volatile double sum = table.sum(a.data(), size);
+            }, 100);
+            benchmarkFunction("Array Add" + suffix, [&]() {
+                table.add(a.data(), b.data(), result2.data(), size);
+            }, 100);
+            
+            std::fill(result2.begin(), result2.end(), 0.0f);
+            table.add(a.data(), b.data(), result2.data(), odd_size);
+            bool add_ok = std::equal(result1.begin(), result1.begin() + odd_size, result2.begin())
+                          && result2[odd_size] == 0.0f;
+            double sum = table.sum(a.data(), odd_size);
+            bool sum_ok = std::abs(sum - reference) <= 1e-4 * std::max(1.0, std::abs(reference)) + 1.0;
+            std::cout << CpuFeatures::name(level) << " check: add " << (add_ok ? "OK" : "FAILED")
+                      << ", sum " << sum << " vs " << reference << (sum_ok ? " OK" : " FAILED") << "\n";
+        }
+        
+        testParallelSIMD();
+    }
+    
+    // 1到N线程的带宽和加速比；并行求和的结果在各线程数下必须逐位相同
+    static void testParallelSIMD() {
+        std::cout << "\n=== Parallel SIMD Sum/Add ===\n";
+        TRACE_SCOPE("SIMDOptimization::testParallelSIMD");
+        
+        size_t hardware_threads = WorkStealingPool::instance().size();
+        std::vector<size_t> thread_counts;
+        for (size_t t = 1; t < hardware_threads; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(hardware_threads);
+        
+        std::vector<size_t> sizes = {size_t(1) << 24};
+        if (benchmarkConfig().full_sizes) sizes.push_back(100000000);
+        
+        for (size_t size : sizes) {
+            std::vector<float> a = Workload::generate<float>({Distribution::Uniform, size, 0.0, 1.0, 7});
+            std::vector<float> b = Workload::generate<float>({Distribution::Uniform, size, 0.0, 1.0, 8});
+            std::vector<float> result(size);
+            int iterations = size > (size_t(1) << 24) ? 5 : 20;
+            
+            float expected = 0.0f;
+            double sum_base = 0.0, add_base = 0.0;
+            bool deterministic = true, add_ok = true;
+            for (size_t threads : thread_counts) {
+                std::string suffix = " n=" + std::to_string(size) + " threads=" + std::to_string(threads);
+                float sum = sumArrayParallel(a.data(), size, threads);
+                if (threads == thread_counts.front()) expected = sum;
+                deterministic = deterministic && sum == expected;
+                
+                double sum_ns = benchmarkFunction("Parallel Sum" + suffix, [&]() {
+                    volatile float r = sumArrayParallel(a.data(), size, threads);
+                }, iterations);
+                double add_ns = benchmarkFunction("Parallel Add" + suffix, [&]() {
+                    addArraysParallel(a.data(), b.data(), result.data(), size, threads);
+                }, iterations);
+                add_ok = add_ok && result[0] == a[0] + b[0] && result[size - 1] == a[size - 1] + b[size - 1];
+                
+                if (threads == thread_counts.front()) {
+                    sum_base = sum_ns;
+                    add_base = add_ns;
+                }
+                std::cout << "  -> sum " << size * sizeof(float) / sum_ns << " GB/s (" << sum_base / sum_ns
+                          << "x), add " << 3.0 * size * sizeof(float) / add_ns << " GB/s ("
+                          << add_base / add_ns << "x)\n";
+            }
+            std::cout << "Parallel check: sum " << (deterministic ? "reproducible" : "NOT reproducible")
+                      << " across thread counts, add " << (add_ok ? "OK" : "FAILED") << "\n";
+        }
+    }
+    
+private:
+    static inline KernelTable kernels = kernelsFor(CpuFeatures::instance().level());
+};
+
+// 归约库：多个独立累加器掩盖加法延迟；可选的累加方式：
+//   Float    - float累加（最快，误差随长度增长）
+//   Double   - 先转成double再累加
+//   Kahan    - float累加加补偿项，精度接近double，仍保持float的宽度
+//   Pairwise - 按块求和后两两合并，误差按log(n)增长
+// 内核有标量版和AVX2+FMA版，按CpuFeatures选择（AVX-512机器上用AVX2版本，
+// 这些归约在1M元素时已接近内存带宽，加宽到512位收益很小）
+class SIMDReductions {
+public:
+    enum class Mode { Float, Double, Kahan, Pairwise };
+    
+    struct MinMax {
+        float min;
+        float max;
+    };
+    
+    struct Moments {
+        double mean;
+        double variance;  // 总体方差
+    };
+    
+    static const char* name(Mode mode) {
+        switch (mode) {
+            case Mode::Float: return "float";
+            case Mode::Double: return "double";
+            case Mode::Kahan: return "kahan";
+            case Mode::Pairwise: return "pairwise";
+        }
+        return "unknown";
+    }
+    
+private:
+    static constexpr size_t kPairwiseBlock = 256;
+    
+    using SumKernel = double (*)(const float*, size_t);
+    using DotKernel = double (*)(const float*, const float*, size_t);
+    
+    struct KernelTable {
+        SumKernel sum[4];
+        DotKernel dot[4];
+        MinMax (*min_max)(const float*, size_t);
+        double (*squared_deviation)(const float*, size_t, double);
+    };
+    
+    // ---- 标量内核：8个累加器 ----
+    
+    static double sumFloatScalar(const float* x, size_t n) {
+        float acc[8] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 8;
+        for (; i < blocked; i += 8) {
+            for (size_t k = 0; k < 8; ++k) acc[k] += x[i + k];
+        }
+        float total = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+        for (; i < n; ++i) total += x[i];
+        return total;
+    }
+    
+    static double sumDoubleScalar(const float* x, size_t n) {
+        double acc[8] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 8;
+        for (; i < blocked; i += 8) {
+            for (size_t k = 0; k < 8; ++k) acc[k] += x[i + k];
+        }
+        double total = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+        for (; i < n; ++i) total += x[i];
+        return total;
+    }
+    
+    static void kahanAdd(float& sum, float& compensation, float value) {
+        float y = value - compensation;
+        float t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+    
+    // 各通道的补偿和合并到double里
+    static double combineKahan(const float* sums, const float* compensations, size_t lanes) {
+        double total = 0.0;
+        for (size_t k = 0; k < lanes; ++k) total += static_cast<double>(sums[k]) - compensations[k];
+        return total;
+    }
+    
+    static double sumKahanScalar(const float* x, size_t n) {
+        float sum[4] = {}, c[4] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 4;
+        for (; i < blocked; i += 4) {
+            for (size_t k = 0; k < 4; ++k) kahanAdd(sum[k], c[k], x[i + k]);
+        }
+        for (; i < n; ++i) kahanAdd(sum[0], c[0], x[i]);
+        return combineKahan(sum, c, 4);
+    }
+    
+    static double dotFloatScalar(const float* a, const float* b, size_t n) {
+        float acc[8] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 8;
+        for (; i < blocked; i += 8) {
+            for (size_t k = 0; k < 8; ++k) acc[k] += a[i + k] * b[i + k];
+        }
+        float total = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+        for (; i < n; ++i) total += a[i] * b[i];
+        return total;
+    }
+    
+    static double dotDoubleScalar(const float* a, const float* b, size_t n) {
+        double acc[4] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 4;
+        for (; i < blocked; i += 4) {
+            for (size_t k = 0; k < 4; ++k) acc[k] += static_cast<double>(a[i + k]) * b[i + k];
+        }
+        double total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < n; ++i) total += static_cast<double>(a[i]) * b[i];
+        return total;
+    }
+    
+    // 两个float的乘积在double里是精确的，拆成高低两部分后把低位并入补偿项
+    static void kahanAddProduct(float& sum, float& compensation, float a, float b) {
+        double product = static_cast<double>(a) * b;
+        float high = static_cast<float>(product);
+        compensation -= static_cast<float>(product - high);
+        kahanAdd(sum, compensation, high);
+    }
+    
+    static double dotKahanScalar(const float* a, const float* b, size_t n) {
+        float sum[4] = {}, c[4] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 4;
+        for (; i < blocked; i += 4) {
+            for (size_t k = 0; k < 4; ++k) kahanAddProduct(sum[k], c[k], a[i + k], b[i + k]);
+        }
+        for (; i < n; ++i) kahanAddProduct(sum[0], c[0], a[i], b[i]);
+        return combineKahan(sum, c, 4);
+    }
+    
+    static MinMax minMaxScalar(const float* x, size_t n) {
+        float lo[4], hi[4];
+        std::fill(lo, lo + 4, std::numeric_limits<float>::infinity());
+        std::fill(hi, hi + 4, -std::numeric_limits<float>::infinity());
+        size_t i = 0;
+        const size_t blocked = n - n % 4;
+        for (; i < blocked; i += 4) {
+            for (size_t k = 0; k < 4; ++k) {
+                lo[k] = std::min(lo[k], x[i + k]);
+                hi[k] = std::max(hi[k], x[i + k]);
+            }
+        }
+        for (; i < n; ++i) {
+            lo[0] = std::min(lo[0], x[i]);
+            hi[0] = std::max(hi[0], x[i]);
+        }
+        return {std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3])),
+                std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]))};
+    }
+    
+    static double squaredDeviationScalar(const float* x, size_t n, double mean) {
+        double acc[4] = {};
+        size_t i = 0;
+        const size_t blocked = n - n % 4;
+        for (; i < blocked; i += 4) {
+            for (size_t k = 0; k < 4; ++k) {
+                double d = x[i + k] - mean;
+                acc[k] += d * d;
+            }
+        }
+        double total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < n; ++i) total += (x[i] - mean) * (x[i] - mean);
+        return total;
+    }
+    
+    // ---- AVX2内核：4个向量累加器 ----
+    
+    __attribute__((target("avx2")))
+    static float horizontalSum(__m256 v) {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+    
+    __attribute__((target("avx2")))
+    static double horizontalSum(__m256d v) {
+        __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+    }
+    
+    __attribute__((target("avx2")))
+    static double sumFloatAVX2(const float* x, size_t n) {
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            a0 = _mm256_add_ps(a0, _mm256_loadu_ps(x + i));
+            a1 = _mm256_add_ps(a1, _mm256_loadu_ps(x + i + 8));
+            a2 = _mm256_add_ps(a2, _mm256_loadu_ps(x + i + 16));
+            a3 = _mm256_add_ps(a3, _mm256_loadu_ps(x + i + 24));
+        }
+        for (; i + 8 <= n; i += 8) {
+            a0 = _mm256_add_ps(a0, _mm256_loadu_ps(x + i));
+        }
+        float total = horizontalSum(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+        // 收尾按剩余个数计数，编译器能给循环定界（i < n的写法在内联后会触发误报）
+        const float* tail = x + i;
+        for (size_t j = 0, rem = n - i; j < rem; ++j) total += tail[j];
+        return total;
+    }
+    
+    __attribute__((target("avx2")))
+    static double sumDoubleAVX2(const float* x, size_t n) {
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            a0 = _mm256_add_pd(a0, _mm256_cvtps_pd(_mm_loadu_ps(x + i)));
+            a1 = _mm256_add_pd(a1, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)));
+            a2 = _mm256_add_pd(a2, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 8)));
+            a3 = _mm256_add_pd(a3, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 12)));
+        }
+        double total = horizontalSum(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+        const float* tail = x + i;
+        for (size_t j = 0, rem = n - i; j < rem; ++j) total += tail[j];
+        return total;
+    }
+    
+    __attribute__((target("avx2")))
+    static void kahanAdd(__m256& sum, __m256& compensation, __m256 value) {
+        __m256 y = _mm256_sub_ps(value, compensation);
+        __m256 t = _mm256_add_ps(sum, y);
+        compensation = _mm256_sub_ps(_mm256_sub_ps(t, sum), y);
+        sum = t;
+    }
+    
+    // 四组累加器按固定顺序逐条合并，同样的输入总得到同样的结果
+    __attribute__((target("avx2")))
+    static double combineKahan(const __m256 (&sum)[4], const __m256 (&compensation)[4]) {
+        alignas(32) float sums[32], compensations[32];
+        for (size_t k = 0; k < 4; ++k) {
+            _mm256_store_ps(sums + 8 * k, sum[k]);
+            _mm256_store_ps(compensations + 8 * k, compensation[k]);
+        }
+        return combineKahan(sums, compensations, 32);
+    }
+    
+    // Kahan每步是四次相互依赖的加减，四条独立的链才能把加法单元排满
+    __attribute__((target("avx2")))
+    static double sumKahanAVX2(const float* x, size_t n) {
+        __m256 s[4], c[4];
+        for (size_t k = 0; k < 4; ++k) s[k] = c[k] = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            kahanAdd(s[0], c[0], _mm256_loadu_ps(x + i));
+            kahanAdd(s[1], c[1], _mm256_loadu_ps(x + i + 8));
+            kahanAdd(s[2], c[2], _mm256_loadu_ps(x + i + 16));
+            kahanAdd(s[3], c[3], _mm256_loadu_ps(x + i + 24));
+        }
+        double total = combineKahan(s, c);
+        return total + sumKahanScalar(x + i, n - i);
+    }
+    
+    __attribute__((target("avx2,fma")))
+    static double dotFloatAVX2(const float* a, const float* b, size_t n) {
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            a0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), a0);
+            a1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), a1);
+            a2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), a2);
+            a3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), a3);
+        }
+        float total = horizontalSum(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+        const float* tail_a = a + i;
+        const float* tail_b = b + i;
+        for (size_t j = 0, rem = n - i; j < rem; ++j) total += tail_a[j] * tail_b[j];
+        return total;
+    }
+    
+    __attribute__((target("avx2,fma")))
+    static double dotDoubleAVX2(const float* a, const float* b, size_t n) {
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            a0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i)), a0);
+            a1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 4)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 4)), a1);
+            a2 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 8)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 8)), a2);
+            a3 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 12)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 12)), a3);
+        }
+        double total = horizontalSum(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+        const float* tail_a = a + i;
+        const float* tail_b = b + i;
+        for (size_t j = 0, rem = n - i; j < rem; ++j) total += static_cast<double>(tail_a[j]) * tail_b[j];
+        return total;
+    }
+    
+    // FMA求出乘积的舍入误差（a*b - p 是精确的），并入补偿项
+    __attribute__((target("avx2,fma")))
+    static void kahanAddProduct(__m256& sum, __m256& compensation, __m256 a, __m256 b) {
+        __m256 product = _mm256_mul_ps(a, b);
+        compensation = _mm256_sub_ps(compensation, _mm256_fmsub_ps(a, b, product));
+        kahanAdd(sum, compensation, product);
+    }
+    
+    __attribute__((target("avx2,fma")))
+    static double dotKahanAVX2(const float* a, const float* b, size_t n) {
+        __m256 s[4], c[4];
+        for (size_t k = 0; k < 4; ++k) s[k] = c[k] = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            kahanAddProduct(s[0], c[0], _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+            kahanAddProduct(s[1], c[1], _mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+            kahanAddProduct(s[2], c[2], _mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+            kahanAddProduct(s[3], c[3], _mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+        }
+        double total = combineKahan(s, c);
+        return total + dotKahanScalar(a + i, b + i, n - i);
+    }
+    
+    __attribute__((target("avx2")))
+    static MinMax minMaxAVX2(const float* x, size_t n) {
+        if (n < 32) return minMaxScalar(x, n);
+        __m256 min0 = _mm256_loadu_ps(x), min1 = _mm256_loadu_ps(x + 8);
+        __m256 min2 = _mm256_loadu_ps(x + 16), min3 = _mm256_loadu_ps(x + 24);
+        __m256 max0 = min0, max1 = min1, max2 = min2, max3 = min3;
+        size_t i = 32;
+        for (; i + 32 <= n; i += 32) {
+            __m256 v0 = _mm256_loadu_ps(x + i);
+            __m256 v1 = _mm256_loadu_ps(x + i + 8);
+            __m256 v2 = _mm256_loadu_ps(x + i + 16);
+            __m256 v3 = _mm256_loadu_ps(x + i + 24);
+            min0 = _mm256_min_ps(min0, v0); max0 = _mm256_max_ps(max0, v0);
+            min1 = _mm256_min_ps(min1, v1); max1 = _mm256_max_ps(max1, v1);
+            min2 = _mm256_min_ps(min2, v2); max2 = _mm256_max_ps(max2, v2);
+            min3 = _mm256_min_ps(min3, v3); max3 = _mm256_max_ps(max3, v3);
+        }
+        alignas(32) float mins[8], maxs[8];
+        _mm256_store_ps(mins, _mm256_min_ps(_mm256_min_ps(min0, min1), _mm256_min_ps(min2, min3)));
+        _mm256_store_ps(maxs, _mm256_max_ps(_mm256_max_ps(max0, max1), _mm256_max_ps(max2, max3)));
+        MinMax result = minMaxScalar(x + i, n - i);
+        for (size_t k = 0; k < 8; ++k) {
+            result.min = std::min(result.min, mins[k]);
+            result.max = std::max(result.max, maxs[k]);
+        }
+        return result;
+    }
+    
+    __attribute__((target("avx2,fma")))
+    static double squaredDeviationAVX2(const float* x, size_t n, double mean) {
+        __m256d m = _mm256_set1_pd(mean);
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256d d0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i)), m);
+            __m256d d1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)), m);
+            __m256d d2 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 8)), m);
+            __m256d d3 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(x + i + 12)), m);
+            a0 = _mm256_fmadd_pd(d0, d0, a0);
+            a1 = _mm256_fmadd_pd(d1, d1, a1);
+            a2 = _mm256_fmadd_pd(d2, d2, a2);
+            a3 = _mm256_fmadd_pd(d3, d3, a3);
+        }
+        double total = horizontalSum(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+        return total + squaredDeviationScalar(x + i, n - i, mean);
+    }
+    
+    // ---- 两两求和：块内用对应的float内核，块之间递归地两两合并（合并也用float） ----
+    
+    template<SumKernel Block>
+    static double sumPairwise(const float* x, size_t n) {
+        if (n <= kPairwiseBlock) {
+            return static_cast<float>(Block(x, n));
+        }
+        size_t half = (n / 2 + kPairwiseBlock - 1) / kPairwiseBlock * kPairwiseBlock;
+        return static_cast<float>(static_cast<float>(sumPairwise<Block>(x, half)) +
+                                  static_cast<float>(sumPairwise<Block>(x + half, n - half)));
+    }
+    
+    template<DotKernel Block>
+    static double dotPairwise(const float* a, const float* b, size_t n) {
+        if (n <= kPairwiseBlock) {
+            return static_cast<float>(Block(a, b, n));
+        }
+        size_t half = (n / 2 + kPairwiseBlock - 1) / kPairwiseBlock * kPairwiseBlock;
+        return static_cast<float>(static_cast<float>(dotPairwise<Block>(a, b, half)) +
+                                  static_cast<float>(dotPairwise<Block>(a + half, b + half, n - half)));
+    }
+    
+    static KernelTable kernelsFor(SimdLevel level) {
+        if (level >= SimdLevel::AVX2) {
+            return {{sumFloatAVX2, sumDoubleAVX2, sumKahanAVX2, sumPairwise<sumFloatAVX2>},
+                    {dotFloatAVX2, dotDoubleAVX2, dotKahanAVX2, dotPairwise<dotFloatAVX2>},
+                    minMaxAVX2, squaredDeviationAVX2};
+        }
+        return {{sumFloatScalar, sumDoubleScalar, sumKahanScalar, sumPairwise<sumFloatScalar>},
+                {dotFloatScalar, dotDoubleScalar, dotKahanScalar, dotPairwise<dotFloatScalar>},
+                minMaxScalar, squaredDeviationScalar};
+    }
+    
+    static inline KernelTable kernels = kernelsFor(CpuFeatures::instance().level());
+    
+public:
+    static void selectKernels(SimdLevel level) {
+        kernels = kernelsFor(level);
+    }
+    
+    static double sum(const float* x, size_t n, Mode mode = Mode::Double) {
+        return kernels.sum[static_cast<int>(mode)](x, n);
+    }
+    
+    static double dot(const float* a, const float* b, size_t n, Mode mode = Mode::Double) {
+        return kernels.dot[static_cast<int>(mode)](a, b, n);
+    }
+    
+    // 空数组返回{+inf, -inf}；含NaN时结果未定义
+    static MinMax minMax(const float* x, size_t n) {
+        return kernels.min_max(x, n);
+    }
+    
+    // 两遍法：先用double求均值，再累加与均值之差的平方，避免 E[x^2]-E[x]^2 的相消误差
+    static Moments meanVariance(const float* x, size_t n) {
+        if (n == 0) return {0.0, 0.0};
+        double mean = sum(x, n, Mode::Double) / n;
+        return {mean, kernels.squared_deviation(x, n, mean) / n};
+    }
+    
+    // 测试吞吐量和相对long double参考值的误差
+    static void testReductions() {
+        std::cout << "\n=== SIMD Reductions Test ===\n";
+        TRACE_SCOPE("SIMDReductions::testReductions");
+        
+        std::vector<size_t> sizes = {size_t(1) << 20};
+        if (benchmarkConfig().full_sizes) sizes.push_back(size_t(1) << 24);
+        
+        for (size_t size : sizes) {
+            // 均值远大于波动的数据：float累加的舍入误差在这种输入上最明显
+            std::vector<float> a = Workload::generate<float>({Distribution::Uniform, size, 9.0, 11.0, 12345});
+            std::vector<float> b = Workload::generate<float>({Distribution::Uniform, size, -1.0, 1.0, 12346});
+            
+            long double ref_sum = 0.0L, ref_dot = 0.0L;
+            for (size_t i = 0; i < size; ++i) {
+                ref_sum += a[i];
+                ref_dot += static_cast<long double>(a[i]) * b[i];
+            }
+            long double ref_mean = ref_sum / size, ref_var = 0.0L;
+            for (size_t i = 0; i < size; ++i) {
+                ref_var += (a[i] - ref_mean) * (a[i] - ref_mean);
+            }
+            ref_var /= size;
+            
+            auto relativeError = [](double value, long double reference) {
+                return static_cast<double>(std::fabs((static_cast<long double>(value) - reference) / reference));
+            };
+            auto report = [&](const std::string& name, size_t bytes, double error, const std::function<void()>& body) {
+                double ns = benchmarkFunction(name, body, 100);
+                std::cout << "  -> " << bytes / ns << " GB/s, relative error " << error << "\n";
+            };
+            std::string suffix = " n=" + std::to_string(size);
+            
+            double single = SIMDOptimization::sumArraySIMD(a.data(), size);
+            report("Sum single accumulator" + suffix, size * sizeof(float), relativeError(single, ref_sum), [&]() {
+                volatile double r = SIMDOptimization::sumArraySIMD(a.data(), size);
+            });
+            for (Mode mode : {Mode::Float, Mode::Double, Mode::Kahan, Mode::Pairwise}) {
+                double value = sum(a.data(), size, mode);
+                report(std::string("Sum ") + name(mode) + suffix, size * sizeof(float),
+                       relativeError(value, ref_sum), [&]() {
+                    volatile double r = sum(a.data(), size, mode);
+                });
+            }
+            for (Mode mode : {Mode::Float, Mode::Double, Mode::Kahan, Mode::Pairwise}) {
+                double value = dot(a.data(), b.data(), size, mode);
+                report(std::string("Dot ") + name(mode) + suffix, 2 * size * sizeof(float),
+                       relativeError(value, ref_dot), [&]() {
+                    volatile double r = dot(a.data(), b.data(), size, mode);
+                });
+            }
+            
+            MinMax expected = minMaxScalar(a.data(), size);
+            MinMax mm = minMax(a.data(), size);
+            // 最值是精确结果，不报告误差，只核对是否与标量版本一致
+            double minmax_ns = benchmarkFunction("MinMax" + suffix, [&]() {
+                volatile float r = minMax(a.data(), size).max;
+            }, 100);
+            std::cout << "  -> " << size * sizeof(float) / minmax_ns << " GB/s\n";
+            bool minmax_ok = mm.min == expected.min && mm.max == expected.max;
+            std::cout << "MinMax check" << suffix << ": " << (minmax_ok ? "OK" : "FAILED") << "\n";
+            
+            Moments moments = meanVariance(a.data(), size);
+            report("MeanVariance" + suffix, 2 * size * sizeof(float),
+                   std::max(relativeError(moments.mean, ref_mean), relativeError(moments.variance, ref_var)), [&]() {
+                volatile double r = meanVariance(a.data(), size).variance;
+            });
+        }
+    }
+};
+
+// 表达式模板：a + b * c - d 这样的逐元素表达式在编译期构造成一棵表达式树，
+// 不产生临时数组；赋值时按当前指令集一次遍历求值，每个元素只读写内存一次。
+// 叶子节点只保存指针和长度，子表达式按值保存，表达式对象本身可以安全地作为临时量传递
+template<typename Derived>
+struct ArrayExpression {
+    const Derived& derived() const { return static_cast<const Derived&>(*this); }
+};
+
+// 数组叶子节点（不拥有数据）
+class ArrayRef : public ArrayExpression<ArrayRef> {
+private:
+    const float* data_;
+    size_t size_;
+    
+public:
+    ArrayRef(const float* data, size_t size) : data_(data), size_(size) {}
+    ArrayRef(const std::vector<float>& values) : data_(values.data()), size_(values.size()) {}
+    
+    size_t size() const { return size_; }
+    float scalar(size_t i) const { return data_[i]; }
+    
+    __attribute__((target("avx2")))
+    __m256 packet(size_t i) const { return _mm256_loadu_ps(data_ + i); }
+};
+
+// 标量叶子节点：广播到任意长度，size()为0表示不限制长度
+class ScalarRef : public ArrayExpression<ScalarRef> {
+private:
+    float value_;
+    
+public:
+    explicit ScalarRef(float value) : value_(value) {}
+    
+    size_t size() const { return 0; }
+    float scalar(size_t) const { return value_; }
+    
+    __attribute__((target("avx2")))
+    __m256 packet(size_t) const { return _mm256_set1_ps(value_); }
+};
+
+struct AddOp {
+    static float apply(float a, float b) { return a + b; }
+    __attribute__((target("avx2"))) static __m256 apply(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+};
+
+struct SubOp {
+    static float apply(float a, float b) { return a - b; }
+    __attribute__((target("avx2"))) static __m256 apply(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+};
+
+struct MulOp {
+    static float apply(float a, float b) { return a * b; }
+    __attribute__((target("avx2"))) static __m256 apply(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+};
+
+struct DivOp {
+    static float apply(float a, float b) { return a / b; }
+    __attribute__((target("avx2"))) static __m256 apply(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+};
+
+template<typename Op, typename L, typename R>
+class BinaryExpression : public ArrayExpression<BinaryExpression<Op, L, R>> {
+private:
+    L left_;
+    R right_;
+    
+public:
+    BinaryExpression(const L& left, const R& right) : left_(left), right_(right) {
+        if (left_.size() != 0 && right_.size() != 0 && left_.size() != right_.size()) {
+            throw std::invalid_argument("array expression size mismatch");
+        }
+    }
+    
+    size_t size() const { return left_.size() != 0 ? left_.size() : right_.size(); }
+    float scalar(size_t i) const { return Op::apply(left_.scalar(i), right_.scalar(i)); }
+    
+    __attribute__((target("avx2")))
+    __m256 packet(size_t i) const { return Op::apply(left_.packet(i), right_.packet(i)); }
+};
+
+#define DEFINE_ARRAY_OPERATOR(symbol, Op)                                                        \
+    template<typename L, typename R>                                                             \
+    BinaryExpression<Op, L, R> operator symbol(const ArrayExpression<L>& l, const ArrayExpression<R>& r) { \
+        return BinaryExpression<Op, L, R>(l.derived(), r.derived());                             \
+    }                                                                                            \
+    template<typename L>                                                                         \
+    BinaryExpression<Op, L, ScalarRef> operator symbol(const ArrayExpression<L>& l, float r) {   \
+        return BinaryExpression<Op, L, ScalarRef>(l.derived(), ScalarRef(r));                    \
+    }                                                                                            \
+    template<typename R>                                                                         \
+    BinaryExpression<Op, ScalarRef, R> operator symbol(float l, const ArrayExpression<R>& r) {   \
+        return BinaryExpression<Op, ScalarRef, R>(ScalarRef(l), r.derived());                    \
+    }
+
+DEFINE_ARRAY_OPERATOR(+, AddOp)
+DEFINE_ARRAY_OPERATOR(-, SubOp)
+DEFINE_ARRAY_OPERATOR(*, MulOp)
+DEFINE_ARRAY_OPERATOR(/, DivOp)
+
+#undef DEFINE_ARRAY_OPERATOR
+
+class FusedArrayOps {
+private:
+    template<typename E>
+    static void evaluateScalar(float* dest, const E& expr, size_t size) {
+        for (size_t i = 0; i < size; ++i) dest[i] = expr.scalar(i);
+    }
+    
+    template<typename E>
+    __attribute__((target("avx2")))
+    static void evaluateAVX2(float* dest, const E& expr, size_t size) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            _mm256_storeu_ps(dest + i, expr.packet(i));
+        }
+        for (; i < size; ++i) dest[i] = expr.scalar(i);
+    }
+    
+public:
+    // 一次遍历把表达式写入dest（dest可以是表达式里的某个输入，但不能与输入部分重叠）；
+    // AVX-512机器上也走AVX2路径
+    template<typename E>
+    static void evaluate(float* dest, const ArrayExpression<E>& expr) {
+        const E& e = expr.derived();
+        if (SIMDOptimization::activeLevel() >= SimdLevel::AVX2) {
+            evaluateAVX2(dest, e, e.size());
+        } else {
+            evaluateScalar(dest, e, e.size());
+        }
+    }
+    
+    template<typename E>
+    static void evaluate(std::vector<float>& dest, const ArrayExpression<E>& expr) {
+        if (dest.size() != expr.derived().size()) {
+            throw std::invalid_argument("array expression size mismatch");
+        }
+        evaluate(dest.data(), expr);
+    }
+    
+    // 融合求值 vs 每个运算单独一遍（中间结果写入临时数组）
+    // 融合求值时乘加可能被收缩成FMA（如-march=native），逐步求值则每步都舍入，
+    // 两者只在最后几位不同；按操作数的量级给绝对容差，而不是要求逐位相等
+    static bool closeEnough(const std::vector<float>& x, const std::vector<float>& y, float magnitude) {
+        const float tolerance = 4.0f * std::numeric_limits<float>::epsilon() * magnitude;
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (!(std::fabs(x[i] - y[i]) <= tolerance)) return false;
+        }
+        return x.size() == y.size();
+    }
+    
+    static void testExpressionTemplates() {
+        std::cout << "\n=== Expression Template Fusion Test ===\n";
+        TRACE_SCOPE("FusedArrayOps::testExpressionTemplates");
+        
+        std::vector<size_t> sizes = {size_t(1) << 20};
+        if (benchmarkConfig().full_sizes) sizes.push_back(100000000);
+        
+        for (size_t size : sizes) {
+            std::vector<float> a = Workload::generate<float>({Distribution::Uniform, size, -1.0, 1.0, 42});
+            std::vector<float> b = Workload::generate<float>({Distribution::Uniform, size, -1.0, 1.0, 43});
+            std::vector<float> c = Workload::generate<float>({Distribution::Uniform, size, -1.0, 1.0, 44});
+            std::vector<float> d = Workload::generate<float>({Distribution::Uniform, size, -1.0, 1.0, 45});
+            std::vector<float> fused(size), chained(size), t1(size), t2(size);
+            ArrayRef A(a), B(b), C(c), D(d);  // 各元素在[-1, 1]内，表达式的操作数量级不超过4
+            int iterations = size > (size_t(1) << 24) ? 5 : 50;
+            std::string suffix = " n=" + std::to_string(size);
+            
+            // a + b + c + d：三次addArraysSIMD（读6写3个数组） vs 一次融合遍历（读4写1个数组）
+            double chained_ns = benchmarkFunction("Chained addArraysSIMD a+b+c+d" + suffix, [&]() {
+                SIMDOptimization::addArraysSIMD(a.data(), b.data(), t1.data(), size);
+                SIMDOptimization::addArraysSIMD(t1.data(), c.data(), t2.data(), size);
+                SIMDOptimization::addArraysSIMD(t2.data(), d.data(), chained.data(), size);
+            }, iterations);
+            double fused_ns = benchmarkFunction("Fused a+b+c+d" + suffix, [&]() {
+                evaluate(fused, A + B + C + D);
+            }, iterations);
+            std::cout << "  -> " << 9.0 * size * sizeof(float) / chained_ns << " GB/s chained vs "
+                      << 5.0 * size * sizeof(float) / fused_ns << " GB/s fused, speedup "
+                      << chained_ns / fused_ns << "x"
+                      << (closeEnough(fused, chained, 4.0f) ? "" : "  [MISMATCH]") << "\n";
+            
+            // a + b * c - d：同一套表达式模板逐个运算求值到临时数组 vs 整棵树一次求值
+            chained_ns = benchmarkFunction("Chained passes a+b*c-d" + suffix, [&]() {
+                evaluate(t1, B * C);
+                evaluate(t2, A + ArrayRef(t1));
+                evaluate(chained, ArrayRef(t2) - D);
+            }, iterations);
+            fused_ns = benchmarkFunction("Fused a+b*c-d" + suffix, [&]() {
+                evaluate(fused, A + B * C - D);
+            }, iterations);
+            std::cout << "  -> speedup " << chained_ns / fused_ns << "x"
+                      << (closeEnough(fused, chained, 4.0f) ? "" : "  [MISMATCH]") << "\n";
+        }
+    }
+};
+
+// =============================================================================
+// 4. 分支预测优化
+// =============================================================================
+
+class BranchOptimization {
+public:
+    // 分支预测不友好的版本
+    static int countPositivesBad(const std::vector<int>& data) {
+        int count = 0;
+        for (int value : data) {
+            if (value > 0) {  // 随机分支，预测困难
+                count++;
+            }
+        }
+        return count;
+    }
+    
+    // 分支预测友好的版本
+    static int countPositivesGood(const std::vector<int>& data) {
+        int count = 0;
+        for (int value : data) {
+            // 使用算术运算代替分支
+            count += (value > 0) ? 1 : 0;  // 编译器可能优化为无分支代码
+        }
+        return count;
+    }
+    
+    // 使用位运算完全避免分支
+    static int countPositivesBest(const std::vector<int>& data) {
+        int count = 0;
+        for (int value : data) {
+            // 利用-value的符号位，完全无分支：只有value > 0时-value为负（放宽到64位，INT_MIN取负不会溢出）
+            count += static_cast<int>(static_cast<uint64_t>(-static_cast<int64_t>(value)) >> 63);
+        }
+        return count;
+    }
+    
+    // 查表法优化
+    static constexpr std::array<int, 256> popcount_table = []() {
+        std::array<int, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            table[i] = __builtin_popcount(i);
+        }
+        return table;
+    }();
+    
+    static int popcountLookup(uint8_t x) {
+        return popcount_table[x];
+    }
+    
+    static int popcountBranches(uint8_t x) {
+        int count = 0;
+        while (x) {
+            if (x & 1) count++;  // 分支预测困难
+            x >>= 1;
+        }
+        return count;
+    }
+    
+    // 向量化的count-if / 过滤（流压缩）：>、<、==、区间都表示成闭区间[lo, hi]，
+    // 判断只需一次无符号比较：(uint32_t)(x - lo) <= (uint32_t)(hi - lo)
+    static_assert(sizeof(int) == 4, "count/filter kernels assume 32-bit int");
+    
+    struct IntPredicate {
+        uint32_t lo = 0;
+        uint32_t span = 0;   // hi - lo（按无符号计算）
+        bool empty = false;  // 例如 x > INT_MAX
+        
+        static IntPredicate between(int lo, int hi) {
+            IntPredicate p;
+            p.lo = static_cast<uint32_t>(lo);
+            p.span = static_cast<uint32_t>(hi) - static_cast<uint32_t>(lo);
+            p.empty = lo > hi;
+            return p;
+        }
+        static IntPredicate greater(int value) {
+            if (value == std::numeric_limits<int>::max()) return between(1, 0);
+            return between(value + 1, std::numeric_limits<int>::max());
+        }
+        static IntPredicate less(int value) {
+            if (value == std::numeric_limits<int>::min()) return between(1, 0);
+            return between(std::numeric_limits<int>::min(), value - 1);
+        }
+        static IntPredicate equal(int value) { return between(value, value); }
+        
+        bool operator()(int x) const {
+            return !empty && static_cast<uint32_t>(x) - lo <= span;
+        }
+    };
+    
+    struct FilterKernels {
+        SimdLevel level;
+        size_t (*count)(const int*, size_t, IntPredicate);
+        size_t (*filter)(const int*, size_t, int*, IntPredicate);  // out至少要有size个元素的空间
+    };
+    
+    static size_t countIfScalar(const int* data, size_t size, IntPredicate pred) {
+        if (pred.empty) return 0;
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i) {
+            count += static_cast<uint32_t>(data[i]) - pred.lo <= pred.span;
+        }
+        return count;
+    }
+    
+    // 无分支：每个元素都写出去，只有满足条件时才推进输出位置
+    static size_t filterScalar(const int* data, size_t size, int* out, IntPredicate pred) {
+        if (pred.empty) return 0;
+        size_t count = 0;
         for (size_t i = 0; i < size; ++i) {
-            a[i] = dis(gen);
-            b[i] = dis(gen);
+            out[count] = data[i];
+            count += static_cast<uint32_t>(data[i]) - pred.lo <= pred.span;
+        }
+        return count;
+    }
+    
+    // AVX2没有无符号比较：两边都异或符号位后用有符号比较，得到“不满足”的掩码
+    __attribute__((target("avx2")))
+    static __m256i rejectMaskAVX2(__m256i x, __m256i lo, __m256i bound) {
+        const __m256i sign = _mm256_set1_epi32(std::numeric_limits<int>::min());
+        return _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_sub_epi32(x, lo), sign), bound);
+    }
+    
+    __attribute__((target("avx2,popcnt")))
+    static size_t countIfAVX2(const int* data, size_t size, IntPredicate pred) {
+        if (pred.empty) return 0;
+        const __m256i lo = _mm256_set1_epi32(static_cast<int>(pred.lo));
+        const __m256i bound = _mm256_set1_epi32(static_cast<int>(pred.span ^ 0x80000000u));
+        size_t rejected = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            __m256i reject = rejectMaskAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), lo, bound);
+            rejected += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(reject)));
+        }
+        return (i - rejected) + countIfScalar(data + i, size - i, pred);
+    }
+    
+    // 8位掩码 -> 把满足条件的通道移到前面的置换下标
+    static constexpr std::array<std::array<int, 8>, 256> compress_table = []() {
+        std::array<std::array<int, 8>, 256> table{};
+        for (int mask = 0; mask < 256; ++mask) {
+            int next = 0;
+            for (int lane = 0; lane < 8; ++lane) {
+                if (mask & (1 << lane)) table[mask][next++] = lane;
+            }
+        }
+        return table;
+    }();
+    
+    // 整8个通道写出（out + count + 8 不会超过 data 已处理的长度），只推进匹配的个数
+    __attribute__((target("avx2,popcnt")))
+    static size_t filterAVX2(const int* data, size_t size, int* out, IntPredicate pred) {
+        if (pred.empty) return 0;
+        const __m256i lo = _mm256_set1_epi32(static_cast<int>(pred.lo));
+        const __m256i bound = _mm256_set1_epi32(static_cast<int>(pred.span ^ 0x80000000u));
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(rejectMaskAVX2(x, lo, bound))) & 0xFF;
+            __m256i permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compress_table[mask].data()));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_permutevar8x32_epi32(x, permutation));
+            count += _mm_popcnt_u32(mask);
+        }
+        return count + filterScalar(data + i, size - i, out + count, pred);
+    }
+    
+    __attribute__((target("avx512f,popcnt")))
+    static size_t countIfAVX512(const int* data, size_t size, IntPredicate pred) {
+        if (pred.empty) return 0;
+        const __m512i lo = _mm512_set1_epi32(static_cast<int>(pred.lo));
+        const __m512i span = _mm512_set1_epi32(static_cast<int>(pred.span));
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m512i offset = _mm512_sub_epi32(_mm512_loadu_si512(data + i), lo);
+            count += _mm_popcnt_u32(_mm512_cmple_epu32_mask(offset, span));
+        }
+        __mmask16 tail = static_cast<__mmask16>((1u << (size - i)) - 1);
+        __m512i offset = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(tail, data + i), lo);
+        return count + _mm_popcnt_u32(_mm512_mask_cmple_epu32_mask(tail, offset, span));
+    }
+    
+    // AVX-512直接用compress-store把匹配的通道连续写出
+    __attribute__((target("avx512f,popcnt")))
+    static size_t filterAVX512(const int* data, size_t size, int* out, IntPredicate pred) {
+        if (pred.empty) return 0;
+        const __m512i lo = _mm512_set1_epi32(static_cast<int>(pred.lo));
+        const __m512i span = _mm512_set1_epi32(static_cast<int>(pred.span));
+        size_t count = 0;
+        size_t i = 0;
+        for (; i < size; i += 16) {
+            __mmask16 valid = size - i >= 16 ? __mmask16(0xFFFF) : static_cast<__mmask16>((1u << (size - i)) - 1);
+            __m512i x = _mm512_maskz_loadu_epi32(valid, data + i);
+            __mmask16 match = _mm512_mask_cmple_epu32_mask(valid, _mm512_sub_epi32(x, lo), span);
+            _mm512_mask_compressstoreu_epi32(out + count, match, x);
+            count += _mm_popcnt_u32(match);
+        }
+        return count;
+    }
+    
+    static FilterKernels filterKernelsFor(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX512: return {level, countIfAVX512, filterAVX512};
+            case SimdLevel::AVX2: return {level, countIfAVX2, filterAVX2};
+            case SimdLevel::SSE2:
+            case SimdLevel::Scalar: break;
+        }
+        return {SimdLevel::Scalar, countIfScalar, filterScalar};
+    }
+    
+    static void selectKernels(SimdLevel level) {
+        filter_kernels = filterKernelsFor(level);
+    }
+    
+    static size_t countIf(const std::vector<int>& data, IntPredicate pred) {
+        return filter_kernels.count(data.data(), data.size(), pred);
+    }
+    
+    // 返回满足条件的元素，保持原有顺序
+    static std::vector<int> filter(const std::vector<int>& data, IntPredicate pred) {
+        std::vector<int> out(data.size());
+        out.resize(filter_kernels.filter(data.data(), data.size(), out.data(), pred));
+        return out;
+    }
+    
+    // 各指令集版本与标量版本对比；长度取非整倍数以覆盖尾部处理
+    static void testVectorizedCountFilter(const std::vector<int>& data) {
+        std::cout << "\nVectorized count/filter kernels: " << CpuFeatures::name(filter_kernels.level) << "\n";
+        TRACE_SCOPE("BranchOptimization::testVectorizedCountFilter");
+        
+        const int int_min = std::numeric_limits<int>::min();
+        const int int_max = std::numeric_limits<int>::max();
+        // 参考结果用直接比较计算，不依赖区间换算
+        struct Case { std::string name; IntPredicate pred; std::function<bool(int)> reference; };
+        std::vector<Case> cases = {
+            {"x > 0", IntPredicate::greater(0), [](int x) { return x > 0; }},
+            {"x < -500", IntPredicate::less(-500), [](int x) { return x < -500; }},
+            {"-100 <= x <= 100", IntPredicate::between(-100, 100), [](int x) { return x >= -100 && x <= 100; }},
+            {"x == 7", IntPredicate::equal(7), [](int x) { return x == 7; }},
+            {"x > INT_MAX", IntPredicate::greater(int_max), [](int) { return false; }},
+            {"x < INT_MIN + 1", IntPredicate::less(int_min + 1), [=](int x) { return x == int_min; }},
+            {"any x", IntPredicate::between(int_min, int_max), [](int) { return true; }},
+        };
+        
+        // 加入极值，检查区间换算在边界上不会溢出
+        std::vector<int> sample(data.begin(), data.begin() + std::min<size_t>(data.size(), 4099));
+        sample[0] = int_min;
+        sample[1] = int_max;
+        sample[2] = 0;
+        std::vector<int> out(sample.size()), expected(sample.size());
+        
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (level > CpuFeatures::instance().level()) continue;
+            FilterKernels kernels = filterKernelsFor(level);
+            bool ok = true;
+            for (const Case& entry : cases) {
+                const IntPredicate& pred = entry.pred;
+                size_t reference = 0;
+                for (int value : sample) {
+                    if (entry.reference(value)) expected[reference++] = value;
+                }
+                size_t count = kernels.count(sample.data(), sample.size(), pred);
+                size_t filtered = kernels.filter(sample.data(), sample.size(), out.data(), pred);
+                if (count != reference || filtered != reference ||
+                    !std::equal(out.begin(), out.begin() + filtered, expected.begin())) {
+                    std::cout << "  " << CpuFeatures::name(level) << " mismatch for " << entry.name << "\n";
+                    ok = false;
+                }
+            }
+            std::cout << CpuFeatures::name(level) << " check: " << (ok ? "OK" : "FAILED") << "\n";
+            
+            std::string suffix = std::string(" [") + CpuFeatures::name(level) + "]";
+            IntPredicate positive = IntPredicate::greater(0);
+            benchmarkFunction("Count Positives" + suffix, [&]() {
+                volatile size_t count = kernels.count(data.data(), data.size(), positive);
+            }, 50);
+            std::vector<int> filtered(data.size());
+            benchmarkFunction("Filter Range" + suffix, [&]() {
+                volatile size_t count = kernels.filter(data.data(), data.size(), filtered.data(),
+                                                       IntPredicate::between(-100, 100));
+            }, 50);
+        }
+    }
+    
+    // 测试分支优化效果
+    static void testBranchOptimization() {
+        std::cout << "\n=== Branch Optimization Test ===\n";
+        TRACE_SCOPE("BranchOptimization::testBranchOptimization");
+        
+        const size_t size = 1000000;
+        std::vector<int> sorted_data(size);
+        
+        // 生成随机数据（分支预测困难）
+        std::vector<int> random_data = Workload::generate<int>({Distribution::Uniform, size, -1000.0, 1000.0, 1});
+        
+        // 生成排序数据（分支预测容易）
+        std::iota(sorted_data.begin(), sorted_data.end(), -500000);
+        
+        std::cout << "Testing with random data (branch prediction hard):\n";
+        benchmarkFunction("Count Positives Bad", [&]() {
+            volatile int count = countPositivesBad(random_data);
+        }, 50);
+        
+        benchmarkFunction("Count Positives Good", [&]() {
+            volatile int count = countPositivesGood(random_data);
+        }, 50);
+        
+        benchmarkFunction("Count Positives Best", [&]() {
+            volatile int count = countPositivesBest(random_data);
+        }, 50);
+        
+        std::cout << "\nTesting with sorted data (branch prediction easy):\n";
+        benchmarkFunction("Count Positives Bad (sorted)", [&]() {
+            volatile int count = countPositivesBad(sorted_data);
+        }, 50);
+        
+        benchmarkFunction("Count Positives Good (sorted)", [&]() {
+            volatile int count = countPositivesGood(sorted_data);
+        }, 50);
+        
+        int bad = countPositivesBad(random_data);
+        bool counts_match = bad == countPositivesGood(random_data) && bad == countPositivesBest(random_data) &&
+                            countPositivesBest(sorted_data) == countPositivesBad(sorted_data);
+        std::cout << "Count positives results match: " << (counts_match ? "Yes" : "No") << "\n";
+        
+        testVectorizedCountFilter(random_data);
+        
+        // 测试查表法
+        std::vector<uint8_t> bytes = Workload::generate<uint8_t>({Distribution::Uniform, size, 0.0, 255.0, 2});
+        
+        benchmarkFunction("Popcount Branches", [&]() {
+            int total = 0;
+            for (uint8_t b : bytes) {
+                total += popcountBranches(b);
+            }
+            volatile int result = total;
+        }, 50);
+        
+        benchmarkFunction("Popcount Lookup", [&]() {
+            int total = 0;
+            for (uint8_t b : bytes) {
+                total += popcountLookup(b);
+            }
+            volatile int result = total;
+        }, 50);
+    }
+    
+private:
+    static inline FilterKernels filter_kernels = filterKernelsFor(CpuFeatures::instance().level());
+};
+
+// 批量popcount：对字节或64位字组成的位图统计1的个数
+//   Lookup      - 逐字节查256项表（BranchOptimization::popcount_table）
+//   SWAR        - 64位字内的位运算，不需要任何特殊指令
+//   POPCNT      - 硬件指令，4个累加器并行
+//   Mula        - AVX2 pshufb按半字节查表，每32字节一次，vpsadbw横向累加
+//   Harley-Seal - AVX2进位保存加法器（CSA）把16个向量压缩成少数几个再做popcount
+// 运行时按CPU特性和数据长度选择：几十字节用标量指令，1 KiB以内用Mula，更长的用Harley-Seal
+class BulkPopcount {
+public:
+    using Kernel = uint64_t (*)(const uint8_t*, size_t);
+    
+    static uint64_t countLookup(const uint8_t* data, size_t bytes) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            total += BranchOptimization::popcountLookup(data[i]);
+        }
+        return total;
+    }
+    
+    static uint64_t popcountWord(uint64_t x) {
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (x * 0x0101010101010101ULL) >> 56;
+    }
+    
+    static uint64_t countSWAR(const uint8_t* data, size_t bytes) {
+        uint64_t total = 0;
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            total += popcountWord(word);
+        }
+        return total + countLookup(data + i, bytes - i);
+    }
+    
+    __attribute__((target("popcnt")))
+    static uint64_t countPOPCNT(const uint8_t* data, size_t bytes) {
+        uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32) {
+            uint64_t w[4];
+            std::memcpy(w, data + i, sizeof(w));
+            c0 += _mm_popcnt_u64(w[0]);
+            c1 += _mm_popcnt_u64(w[1]);
+            c2 += _mm_popcnt_u64(w[2]);
+            c3 += _mm_popcnt_u64(w[3]);
+        }
+        for (; i + 8 <= bytes; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            c0 += _mm_popcnt_u64(word);
+        }
+        return (c0 + c1) + (c2 + c3) + countLookup(data + i, bytes - i);
+    }
+    
+private:
+    // 每个字节的1的个数：低、高半字节分别查16项表
+    __attribute__((target("avx2")))
+    static __m256i popcountBytes(__m256i v) {
+        const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                               0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0F);
+        __m256i low = _mm256_and_si256(v, low_mask);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        return _mm256_add_epi8(_mm256_shuffle_epi8(table, low), _mm256_shuffle_epi8(table, high));
+    }
+    
+    // 每个64位通道的1的个数
+    __attribute__((target("avx2")))
+    static __m256i popcount256(__m256i v) {
+        return _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256());
+    }
+    
+    __attribute__((target("avx2")))
+    static uint64_t horizontalSum(__m256i v) {
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    
+    __attribute__((target("avx2")))
+    static __m256i load(const uint8_t* data) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    }
+    
+    // 进位保存加法：a+b+c的每一位拆成进位high和本位low
+    __attribute__((target("avx2")))
+    static void csa(__m256i& high, __m256i& low, __m256i a, __m256i b, __m256i c) {
+        __m256i u = _mm256_xor_si256(a, b);
+        high = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+        low = _mm256_xor_si256(u, c);
+    }
+    
+public:
+    // 字节计数器最多累加31次（31*8 < 256）后用vpsadbw并入64位累加器
+    __attribute__((target("avx2")))
+    static uint64_t countMula(const uint8_t* data, size_t bytes) {
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+        while (i + 32 <= bytes) {
+            __m256i local = _mm256_setzero_si256();
+            for (int k = 0; k < 31 && i + 32 <= bytes; ++k, i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                local = _mm256_add_epi8(local, popcountBytes(v));
+            }
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(local, _mm256_setzero_si256()));
+        }
+        return horizontalSum(total) + countSWAR(data + i, bytes - i);
+    }
+    
+    // 每512字节（16个向量）只对sixteens做一次popcount，其余位权留在ones/twos/fours/eights里
+    __attribute__((target("avx2")))
+    static uint64_t countHarleySeal(const uint8_t* data, size_t bytes) {
+        __m256i total = _mm256_setzero_si256();
+        __m256i ones = _mm256_setzero_si256(), twos = _mm256_setzero_si256();
+        __m256i fours = _mm256_setzero_si256(), eights = _mm256_setzero_si256();
+        __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+        size_t i = 0;
+        for (; i + 512 <= bytes; i += 512) {
+            csa(twos_a, ones, ones, load(data + i), load(data + i + 32));
+            csa(twos_b, ones, ones, load(data + i + 64), load(data + i + 96));
+            csa(fours_a, twos, twos, twos_a, twos_b);
+            csa(twos_a, ones, ones, load(data + i + 128), load(data + i + 160));
+            csa(twos_b, ones, ones, load(data + i + 192), load(data + i + 224));
+            csa(fours_b, twos, twos, twos_a, twos_b);
+            csa(eights_a, fours, fours, fours_a, fours_b);
+            csa(twos_a, ones, ones, load(data + i + 256), load(data + i + 288));
+            csa(twos_b, ones, ones, load(data + i + 320), load(data + i + 352));
+            csa(fours_a, twos, twos, twos_a, twos_b);
+            csa(twos_a, ones, ones, load(data + i + 384), load(data + i + 416));
+            csa(twos_b, ones, ones, load(data + i + 448), load(data + i + 480));
+            csa(fours_b, twos, twos, twos_a, twos_b);
+            csa(eights_b, fours, fours, fours_a, fours_b);
+            csa(sixteens, eights, eights, eights_a, eights_b);
+            total = _mm256_add_epi64(total, popcount256(sixteens));
         }
+        total = _mm256_slli_epi64(total, 4);
+        total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+        total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+        total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+        total = _mm256_add_epi64(total, popcount256(ones));
+        return horizontalSum(total) + countMula(data + i, bytes - i);
+    }
+    
+    // 分界点来自本文件的基准：更短时向量内核的收尾开销占比太大
+    static constexpr size_t kMulaThreshold = 64;
+    static constexpr size_t kHarleySealThreshold = 1024;
+    
+    static uint64_t count(const uint8_t* data, size_t bytes) {
+        if (bytes >= kHarleySealThreshold) return kernels.large(data, bytes);
+        if (bytes >= kMulaThreshold) return kernels.medium(data, bytes);
+        return kernels.small(data, bytes);
+    }
+    
+    static uint64_t count(const uint64_t* words, size_t size) {
+        return count(reinterpret_cast<const uint8_t*>(words), size * sizeof(uint64_t));
+    }
+    
+    static void selectKernels(SimdLevel level) {
+        kernels = kernelsFor(level);
+    }
+    
+    static void testBulkPopcount() {
+        std::cout << "\n=== Bulk Popcount Test ===\n";
+        TRACE_SCOPE("BulkPopcount::testBulkPopcount");
         
-        // 测试数组求和
-        benchmarkFunction("Array Sum Scalar", [&]() {
-            volatile double sum = sumArrayScalar(a.data(), size);
-        }, 100);
+        CpuFeatures& cpu = CpuFeatures::instance();
+        std::vector<std::pair<std::string, Kernel>> candidates = {
+            {"Lookup", countLookup}, {"SWAR", countSWAR}};
+        if (cpu.hasPopcnt()) candidates.push_back({"POPCNT", countPOPCNT});
+        if (cpu.level() >= SimdLevel::AVX2) {
+            candidates.push_back({"Mula", countMula});
+            candidates.push_back({"Harley-Seal", countHarleySeal});
+        }
+        candidates.push_back({"Auto", [](const uint8_t* data, size_t bytes) { return count(data, bytes); }});
         
-        benchmarkFunction("Array Sum SIMD", [&]() {
-            volatile double sum = sumArraySIMD(a.data(), size);
-        }, 100);
+        std::vector<size_t> sizes = {size_t(1) << 10, size_t(1) << 16, size_t(1) << 20, size_t(1) << 24};
+        if (benchmarkConfig().full_sizes) {
+            sizes.push_back(size_t(1) << 28);
+            sizes.push_back(size_t(1) << 30);
+        }
         
-        // 测试向量加法
-        benchmarkFunction("Array Add Scalar", [&]() {
-            addArraysScalar(a.data(), b.data(), result1.data(), size);
-        }, 100);
+        Xoshiro256 gen = Workload::rng(99);
+        std::vector<uint64_t> words((sizes.back() + 64) / sizeof(uint64_t));
+        for (uint64_t& word : words) word = gen();
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(words.data());
         
-        benchmarkFunction("Array Add SIMD", [&]() {
-            addArraysSIMD(a.data(), b.data(), result2.data(), size);
-        }, 100);
+        // 非对齐起点和非整倍数长度覆盖各内核的收尾处理
+        bool ok = true;
+        for (size_t length : {size_t(0), size_t(7), size_t(31), size_t(100), size_t(511), size_t(513),
+                              size_t(1030), size_t(4099), size_t(100003)}) {
+            uint64_t expected = countLookup(bytes + 3, length);
+            for (const auto& candidate : candidates) {
+                if (candidate.second(bytes + 3, length) != expected) {
+                    std::cout << "  " << candidate.first << " mismatch at length " << length << "\n";
+                    ok = false;
+                }
+            }
+        }
+        std::cout << "Popcount kernels check: " << (ok ? "OK" : "FAILED") << "\n";
         
-        // 验证结果正确性
-        bool results_match = std::equal(result1.begin(), result1.end(), result2.begin(),
-            [](float a, float b) { return std::abs(a - b) < 1e-6f; });
-        std::cout << "Results match: " << (results_match ? "Yes" : "No") << std::endl;
+        for (size_t size : sizes) {
+            std::string suffix = " " + formatBytes(size);
+            int iterations = size >= (size_t(1) << 28) ? 3 : 20;
+            for (const auto& candidate : candidates) {
+                // 逐字节查表在1GB上要跑好几秒，只在较小的长度上作为基线
+                if (candidate.second == countLookup && size > (size_t(1) << 24)) continue;
+                Kernel kernel = candidate.second;
+                double ns = benchmarkFunction("Popcount " + candidate.first + suffix, [&]() {
+                    volatile uint64_t r = kernel(bytes, size);
+                }, iterations);
+                std::cout << "  -> " << size / ns << " GB/s\n";
+            }
+        }
+    }
+    
+private:
+    struct KernelTable {
+        Kernel small;
+        Kernel medium;
+        Kernel large;
+    };
+    
+    static KernelTable kernelsFor(SimdLevel level) {
+        Kernel scalar = CpuFeatures::instance().hasPopcnt() && level != SimdLevel::Scalar ? countPOPCNT : countSWAR;
+        if (level >= SimdLevel::AVX2) return {scalar, countMula, countHarleySeal};
+        return {scalar, scalar, scalar};
     }
+    
+    static inline KernelTable kernels = kernelsFor(CpuFeatures::instance().level());
 };
 
 // =============================================================================
-// 4. 分支预测优化
+// 5. 数据结构优化
 // =============================================================================
 
-class BranchOptimization {
+// 传统的链表节点（缓存不友好）
+struct ListNode {
+    int data;
+    ListNode* next;
+    
+    ListNode(int val) : data(val), next(nullptr) {}
+};
+
+// 缓存友好的数组链表
+class ArrayBasedList {
+private:
+    struct Node {
+        int data;
+        int next;  // 索引而不是指针
+    };
+    
+    std::vector<Node> nodes;
+    int head;
+    int free_list;
+    
 public:
-    // 分支预测不友好的版本
-    static int countPositivesBad(const std::vector<int>& data) {
-        int count = 0;
-        for (int value : data) {
-            if (value > 0) {  // 随机分支，预测困难
-                count++;
+    explicit ArrayBasedList(size_t capacity = 1000) : head(-1), free_list(-1) {
+        nodes.reserve(capacity);  // 预分配
+    }
+    
+    int allocateNode() {
+        if (free_list != -1) {
+            int index = free_list;
+            free_list = nodes[free_list].next;
+            return index;
+        }
+        nodes.emplace_back();
+        return nodes.size() - 1;
+    }
+    
+    void push_front(int value) {
+        int new_index = allocateNode();
+        nodes[new_index].data = value;
+        nodes[new_index].next = head;
+        head = new_index;
+    }
+    
+    // 插入到第position个位置（要从头走position步）；超出长度时插在末尾
+    void insert(size_t position, int value) {
+        if (position == 0 || head == -1) {
+            push_front(value);
+            return;
+        }
+        int previous = head;
+        for (size_t i = 1; i < position && nodes[previous].next != -1; ++i) {
+            previous = nodes[previous].next;
+        }
+        int new_index = allocateNode();
+        nodes[new_index].data = value;
+        nodes[new_index].next = nodes[previous].next;
+        nodes[previous].next = new_index;
+    }
+    
+    void pop_front() {
+        if (head != -1) {
+            int old_head = head;
+            head = nodes[head].next;
+            nodes[old_head].next = free_list;
+            free_list = old_head;
+        }
+    }
+    
+    long long sum() const {
+        long long total = 0;
+        int current = head;
+        while (current != -1) {
+            total += nodes[current].data;
+            current = nodes[current].next;
+        }
+        return total;
+    }
+};
+
+// 通用的索引链表：节点用32位下标互相链接，结构数组（SoA）布局，
+// next/prev下标与数据分开存放，遍历时只读取next和数据两条连续数组。
+// 句柄就是节点下标，插入/删除不会使其他句柄失效；compact()按遍历顺序重新编号节点，
+// 之后的遍历变成顺序访问，但所有句柄和迭代器都会失效。
+// 删除的槽位进入空闲链表复用，数据被重置为T()以释放其持有的资源（要求T可默认构造）
+template<typename T>
+class IndexedList {
+public:
+    using Index = uint32_t;
+    static constexpr Index kNull = std::numeric_limits<Index>::max();
+    
+    struct Handle {
+        Index index = kNull;
+        bool operator==(Handle other) const { return index == other.index; }
+        bool operator!=(Handle other) const { return index != other.index; }
+    };
+    
+private:
+    std::vector<T> values_;
+    std::vector<Index> next_;
+    std::vector<Index> prev_;
+    Index head_ = kNull;
+    Index tail_ = kNull;
+    Index free_ = kNull;  // 空闲槽位通过next_串起来
+    size_t size_ = 0;
+    
+    Index allocateSlot(T&& value) {
+        if (free_ != kNull) {
+            Index slot = free_;
+            free_ = next_[slot];
+            values_[slot] = std::move(value);
+            return slot;
+        }
+        if (values_.size() >= kNull) {
+            throw std::length_error("IndexedList exceeds 32-bit index space");
+        }
+        values_.push_back(std::move(value));
+        next_.push_back(kNull);
+        prev_.push_back(kNull);
+        return static_cast<Index>(values_.size() - 1);
+    }
+    
+    // 把slot链接到before之前；before为kNull时追加到末尾
+    Handle link(Index slot, Index before) {
+        Index after = before == kNull ? tail_ : prev_[before];
+        next_[slot] = before;
+        prev_[slot] = after;
+        if (after == kNull) head_ = slot; else next_[after] = slot;
+        if (before == kNull) tail_ = slot; else prev_[before] = slot;
+        ++size_;
+        return Handle{slot};
+    }
+    
+public:
+    template<bool Const>
+    class Iterator {
+    private:
+        using List = std::conditional_t<Const, const IndexedList, IndexedList>;
+        List* list_ = nullptr;
+        Index index_ = kNull;
+        
+        friend class IndexedList;
+        Iterator(List* list, Index index) : list_(list), index_(index) {}
+        
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+        
+        Iterator() = default;
+        operator Iterator<true>() const { return Iterator<true>(list_, index_); }
+        
+        reference operator*() const { return list_->values_[index_]; }
+        pointer operator->() const { return &list_->values_[index_]; }
+        Handle handle() const { return Handle{index_}; }
+        
+        Iterator& operator++() { index_ = list_->next_[index_]; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++*this; return old; }
+        // end()--得到最后一个元素
+        Iterator& operator--() { index_ = index_ == kNull ? list_->tail_ : list_->prev_[index_]; return *this; }
+        Iterator operator--(int) { Iterator old = *this; --*this; return old; }
+        
+        bool operator==(const Iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+    };
+    
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+    
+    IndexedList() = default;
+    
+    void reserve(size_t capacity) {
+        values_.reserve(capacity);
+        next_.reserve(capacity);
+        prev_.reserve(capacity);
+    }
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return values_.size(); }  // 已分配的槽位数（含空闲槽位）
+    
+    iterator begin() { return iterator(this, head_); }
+    iterator end() { return iterator(this, kNull); }
+    const_iterator begin() const { return const_iterator(this, head_); }
+    const_iterator end() const { return const_iterator(this, kNull); }
+    
+    Handle front() const { return Handle{head_}; }
+    Handle back() const { return Handle{tail_}; }
+    Handle next(Handle handle) const { return Handle{next_[handle.index]}; }
+    Handle prev(Handle handle) const { return Handle{prev_[handle.index]}; }
+    
+    T& operator[](Handle handle) { return values_[handle.index]; }
+    const T& operator[](Handle handle) const { return values_[handle.index]; }
+    
+    Handle push_front(T value) { return link(allocateSlot(std::move(value)), head_); }
+    Handle push_back(T value) { return link(allocateSlot(std::move(value)), kNull); }
+    
+    // 插入到pos之前；pos为空句柄时追加到末尾
+    Handle insert(Handle pos, T value) { return link(allocateSlot(std::move(value)), pos.index); }
+    
+    // 删除节点，返回下一个节点的句柄
+    Handle erase(Handle handle) {
+        Index slot = handle.index;
+        Index before = prev_[slot], after = next_[slot];
+        if (before == kNull) head_ = after; else next_[before] = after;
+        if (after == kNull) tail_ = before; else prev_[after] = before;
+        values_[slot] = T();
+        next_[slot] = free_;
+        prev_[slot] = kNull;
+        free_ = slot;
+        --size_;
+        return Handle{after};
+    }
+    
+    void pop_front() { if (head_ != kNull) erase(Handle{head_}); }
+    
+    void clear() {
+        values_.clear();
+        next_.clear();
+        prev_.clear();
+        head_ = tail_ = free_ = kNull;
+        size_ = 0;
+    }
+    
+    // 按遍历顺序重排：第i个节点放到槽位i，next/prev变成i±1，空闲槽位被丢弃
+    void compact() {
+        std::vector<T> values;
+        values.reserve(size_);
+        for (Index slot = head_; slot != kNull; slot = next_[slot]) {
+            values.push_back(std::move(values_[slot]));
+        }
+        values_ = std::move(values);
+        next_.resize(size_);
+        prev_.resize(size_);
+        next_.shrink_to_fit();
+        prev_.shrink_to_fit();
+        for (size_t i = 0; i < size_; ++i) {
+            next_[i] = i + 1 < size_ ? static_cast<Index>(i + 1) : kNull;
+            prev_[i] = i > 0 ? static_cast<Index>(i - 1) : kNull;
+        }
+        head_ = size_ > 0 ? 0 : kNull;
+        tail_ = size_ > 0 ? static_cast<Index>(size_ - 1) : kNull;
+        free_ = kNull;
+    }
+};
+
+// 链表遍历的代价取决于节点在内存里的排列：随机位置插入让遍历顺序与槽位顺序无关，
+// compact()之后同一条遍历变成顺序扫描
+void testIndexedList() {
+    std::cout << "\n=== Indexed List Compaction Test ===\n";
+    TRACE_SCOPE("testIndexedList");
+    
+    std::vector<size_t> sizes = {1000000};
+    if (benchmarkConfig().full_sizes) sizes.push_back(10000000);
+    
+    for (size_t n : sizes) {
+        IndexedList<int> list;
+        list.reserve(n);
+        std::vector<IndexedList<int>::Handle> handles;
+        handles.reserve(n);
+        Pcg32 gen = Workload::pcg(2024);
+        
+        // 每个新节点插在随机一个已有节点之前，再随机删掉十分之一并重新插入（复用空闲槽位）
+        handles.push_back(list.push_back(0));
+        for (size_t i = 1; i < n; ++i) {
+            handles.push_back(list.insert(handles[gen.below(static_cast<uint32_t>(handles.size()))], static_cast<int>(i)));
+        }
+        for (size_t i = 0; i < n / 10; ++i) {
+            size_t victim = gen.below(static_cast<uint32_t>(handles.size()));
+            size_t target = gen.below(static_cast<uint32_t>(handles.size()));
+            if (target == victim) continue;
+            int value = list[handles[victim]];
+            list.erase(handles[victim]);
+            handles[victim] = list.insert(handles[target], value);
+        }
+        handles.clear();
+        handles.shrink_to_fit();
+        
+        auto traverse = [&list]() {
+            long long sum = 0;
+            for (int value : list) sum += value;
+            return sum;
+        };
+        const long long expected = static_cast<long long>(n) * (n - 1) / 2;
+        std::vector<int> order_before(list.begin(), list.end());
+        
+        std::string suffix = " n=" + std::to_string(n);
+        int iterations = n > 1000000 ? 3 : 10;
+        double scattered = benchmarkFunction("IndexedList traversal (scattered)" + suffix, [&]() {
+            volatile long long sum = traverse();
+        }, iterations);
+        
+        auto start = std::chrono::steady_clock::now();
+        list.compact();
+        double compact_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        double compacted = benchmarkFunction("IndexedList traversal (compacted)" + suffix, [&]() {
+            volatile long long sum = traverse();
+        }, iterations);
+        
+        bool ok = traverse() == expected && list.size() == n &&
+                  std::equal(order_before.begin(), order_before.end(), list.begin());
+        std::cout << "compact() took " << compact_ms << " ms, traversal speedup "
+                  << scattered / compacted << "x, order preserved: " << (ok ? "Yes" : "No") << "\n";
+    }
+}
+
+// 展开链表：每个节点存一段连续元素（默认512字节，即8条缓存行），节点之间双向链接。
+// 中间插入/删除只移动一个节点内的元素：节点满了对半分裂，删到不足1/4时与后继合并或从后继借一半，
+// 所以单次修改是O(节点容量)的常数代价；顺序扫描基本是逐个节点扫连续数组，接近vector。
+// 定位第i个元素按节点跳，是O(n/节点容量)。元素类型要求可默认构造、可移动赋值
+template<typename T, size_t NodeBytes = 512>
+class UnrolledList {
+public:
+    static constexpr size_t kCapacity = NodeBytes / sizeof(T) >= 4 ? NodeBytes / sizeof(T) : 4;
+    
+private:
+    struct alignas(64) Node {
+        T items[kCapacity];
+        size_t count = 0;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+    };
+    
+    Node* head_ = nullptr;
+    Node* tail_ = nullptr;
+    size_t size_ = 0;
+    
+    // 在node之后挂一个新节点（node为空时放在表头）
+    Node* linkAfter(Node* node) {
+        Node* fresh = new Node;
+        fresh->prev = node;
+        fresh->next = node ? node->next : head_;
+        if (fresh->next) fresh->next->prev = fresh; else tail_ = fresh;
+        if (node) node->next = fresh; else head_ = fresh;
+        return fresh;
+    }
+    
+    void unlink(Node* node) {
+        if (node->prev) node->prev->next = node->next; else head_ = node->next;
+        if (node->next) node->next->prev = node->prev; else tail_ = node->prev;
+        delete node;
+    }
+    
+    // 从next的开头搬count个元素到node的末尾
+    static void moveFromNext(Node* node, Node* next, size_t count) {
+        std::move(next->items, next->items + count, node->items + node->count);
+        std::move(next->items + count, next->items + next->count, next->items);
+        std::fill(next->items + next->count - count, next->items + next->count, T());
+        node->count += count;
+        next->count -= count;
+    }
+    
+public:
+    template<bool Const>
+    class Iterator {
+    private:
+        using NodePtr = std::conditional_t<Const, const Node*, Node*>;
+        NodePtr node_ = nullptr;
+        size_t index_ = 0;
+        
+        friend class UnrolledList;
+        Iterator(NodePtr node, size_t index) : node_(node), index_(index) {}
+        
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+        
+        Iterator() = default;
+        operator Iterator<true>() const { return Iterator<true>(node_, index_); }
+        
+        reference operator*() const { return node_->items[index_]; }
+        pointer operator->() const { return &node_->items[index_]; }
+        
+        Iterator& operator++() {
+            if (++index_ == node_->count) {
+                node_ = node_->next;
+                index_ = 0;
             }
+            return *this;
+        }
+        Iterator operator++(int) { Iterator old = *this; ++*this; return old; }
+        
+        bool operator==(const Iterator& other) const { return node_ == other.node_ && index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    };
+    
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+    
+    UnrolledList() = default;
+    UnrolledList(const UnrolledList&) = delete;
+    UnrolledList& operator=(const UnrolledList&) = delete;
+    
+    UnrolledList(UnrolledList&& other) noexcept
+        : head_(std::exchange(other.head_, nullptr)), tail_(std::exchange(other.tail_, nullptr)),
+          size_(std::exchange(other.size_, 0)) {}
+    
+    UnrolledList& operator=(UnrolledList&& other) noexcept {
+        if (this != &other) {
+            clear();
+            head_ = std::exchange(other.head_, nullptr);
+            tail_ = std::exchange(other.tail_, nullptr);
+            size_ = std::exchange(other.size_, 0);
         }
-        return count;
+        return *this;
     }
     
-    // 分支预测友好的版本
-    static int countPositivesGood(const std::vector<int>& data) {
-        int count = 0;
-        for (int value : data) {
-            // 使用算术运算代替分支
-            count += (value > 0) ? 1 : 0;  // 编译器可能优化为无分支代码
+    ~UnrolledList() { clear(); }
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    
+    iterator begin() { return iterator(head_, 0); }
+    iterator end() { return iterator(nullptr, 0); }
+    const_iterator begin() const { return const_iterator(head_, 0); }
+    const_iterator end() const { return const_iterator(nullptr, 0); }
+    
+    void clear() {
+        while (head_) {
+            Node* next = head_->next;
+            delete head_;
+            head_ = next;
         }
-        return count;
+        tail_ = nullptr;
+        size_ = 0;
     }
     
-    // 使用位运算完全避免分支
-    static int countPositivesBest(const std::vector<int>& data) {
-        int count = 0;
-        for (int value : data) {
-            // 利用符号位，完全无分支
-            count += (value >> 31) ^ 1;  // 如果value >= 0，则+1
-        }
-        return count;
+    void push_back(T value) {
+        if (!tail_ || tail_->count == kCapacity) linkAfter(tail_);
+        tail_->items[tail_->count++] = std::move(value);
+        ++size_;
     }
     
-    // 查表法优化
-    static constexpr std::array<int, 256> popcount_table = []() {
-        std::array<int, 256> table{};
-        for (int i = 0; i < 256; ++i) {
-            table[i] = __builtin_popcount(i);
+    // 第index个元素的迭代器，按节点元素个数整段跳过；index == size()时返回end()
+    iterator at(size_t index) {
+        Node* node = head_;
+        while (node && index >= node->count) {
+            index -= node->count;
+            node = node->next;
         }
-        return table;
-    }();
-    
-    static int popcountLookup(uint8_t x) {
-        return popcount_table[x];
+        return iterator(node, node ? index : 0);
     }
     
-    static int popcountBranches(uint8_t x) {
-        int count = 0;
-        while (x) {
-            if (x & 1) count++;  // 分支预测困难
-            x >>= 1;
+    // 插入到pos之前，返回指向新元素的迭代器；其他迭代器失效
+    iterator insert(iterator pos, T value) {
+        if (pos == end()) {
+            push_back(std::move(value));
+            return iterator(tail_, tail_->count - 1);
         }
-        return count;
+        Node* node = pos.node_;
+        size_t index = pos.index_;
+        if (node->count == kCapacity) {
+            Node* fresh = linkAfter(node);
+            size_t keep = kCapacity / 2;
+            std::move(node->items + keep, node->items + kCapacity, fresh->items);
+            std::fill(node->items + keep, node->items + kCapacity, T());
+            fresh->count = kCapacity - keep;
+            node->count = keep;
+            if (index > keep) {
+                index -= keep;
+                node = fresh;
+            }
+        }
+        std::move_backward(node->items + index, node->items + node->count, node->items + node->count + 1);
+        node->items[index] = std::move(value);
+        ++node->count;
+        ++size_;
+        return iterator(node, index);
     }
     
-    // 测试分支优化效果
-    static void testBranchOptimization() {
-        std::cout << "\n=== Branch Optimization Test ===\n";
-        
-        const size_t size = 1000000;
-        std::vector<int> random_data(size);
-        std::vector<int> sorted_data(size);
-        
-        // 生成随机数据（分支预测困难）
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> dis(-1000, 1000);
+    // 删除pos处的元素，返回指向下一个元素的迭代器；其他迭代器失效
+    iterator erase(iterator pos) {
+        Node* node = pos.node_;
+        size_t index = pos.index_;
+        std::move(node->items + index + 1, node->items + node->count, node->items + index);
+        node->items[--node->count] = T();
+        --size_;
         
-        for (size_t i = 0; i < size; ++i) {
-            random_data[i] = dis(gen);
+        if (node->count == 0) {
+            Node* next = node->next;
+            unlink(node);
+            return iterator(next, 0);
         }
-        
-        // 生成排序数据（分支预测容易）
-        std::iota(sorted_data.begin(), sorted_data.end(), -500000);
-        
-        std::cout << "Testing with random data (branch prediction hard):\n";
-        benchmarkFunction("Count Positives Bad", [&]() {
-            volatile int count = countPositivesBad(random_data);
-        }, 50);
-        
-        benchmarkFunction("Count Positives Good", [&]() {
-            volatile int count = countPositivesGood(random_data);
-        }, 50);
-        
-        benchmarkFunction("Count Positives Best", [&]() {
-            volatile int count = countPositivesBest(random_data);
-        }, 50);
-        
-        std::cout << "\nTesting with sorted data (branch prediction easy):\n";
-        benchmarkFunction("Count Positives Bad (sorted)", [&]() {
-            volatile int count = countPositivesBad(sorted_data);
-        }, 50);
-        
-        benchmarkFunction("Count Positives Good (sorted)", [&]() {
-            volatile int count = countPositivesGood(sorted_data);
-        }, 50);
-        
-        // 测试查表法
-        std::vector<uint8_t> bytes(size);
-        std::generate(bytes.begin(), bytes.end(), [&]() { return dis(gen) & 0xFF; });
-        
-        benchmarkFunction("Popcount Branches", [&]() {
-            int total = 0;
-            for (uint8_t b : bytes) {
-                total += popcountBranches(b);
-            }
-            volatile int result = total;
-        }, 50);
-        
-        benchmarkFunction("Popcount Lookup", [&]() {
-            int total = 0;
-            for (uint8_t b : bytes) {
-                total += popcountLookup(b);
+        Node* next = node->next;
+        if (node->count < kCapacity / 4 && next) {
+            if (node->count + next->count <= kCapacity / 2) {
+                moveFromNext(node, next, next->count);
+                unlink(next);
+            } else {
+                moveFromNext(node, next, (next->count - node->count) / 2);
             }
-            volatile int result = total;
-        }, 50);
+        }
+        // 合并或借用只会往node末尾追加，下一个元素要么仍在index处，要么是后继节点的开头
+        return index < node->count ? iterator(node, index) : iterator(node->next, 0);
     }
-};
-
-// =============================================================================
-// 5. 数据结构优化
-// =============================================================================
-
-// 传统的链表节点（缓存不友好）
-struct ListNode {
-    int data;
-    ListNode* next;
     
-    ListNode(int val) : data(val), next(nullptr) {}
+    // 按节点把连续的元素段交给f(const T*, size_t)，内层循环可以被向量化
+    template<typename F>
+    void forEachSegment(F&& f) const {
+        for (const Node* node = head_; node; node = node->next) {
+            f(node->items, node->count);
+        }
+    }
 };
 
-// 缓存友好的数组链表
-class ArrayBasedList {
-private:
-    struct Node {
-        int data;
-        int next;  // 索引而不是指针
+// 中间插入 + 周期性全量扫描的混合负载：vector插入要搬移后半段，
+// std::list和ArrayBasedList定位要逐个节点走，展开链表按节点跳再在节点内搬移
+void testUnrolledList() {
+    std::cout << "\n=== Unrolled List Test ===\n";
+    TRACE_SCOPE("testUnrolledList");
+    
+    const size_t initial = 50000;
+    const size_t inserts = 1000;
+    const size_t scan_every = 100;
+    std::vector<size_t> positions(inserts);
+    Pcg32 gen = Workload::pcg(77);
+    for (size_t k = 0; k < inserts; ++k) {
+        positions[k] = gen.below(static_cast<uint32_t>(initial + k + 1));
+    }
+    
+    // 每个负载返回最后一次扫描的和，用来核对各容器的结果一致
+    auto run = [&](const std::string& name, auto&& make, auto&& insert_at, auto&& scan) {
+        long long checksum = 0;
+        benchmarkFunction("Middle insert + scan [" + name + "]", [&]() {
+            auto container = make();
+            long long total = 0;
+            for (size_t k = 0; k < inserts; ++k) {
+                insert_at(container, positions[k], static_cast<int>(k));
+                if ((k + 1) % scan_every == 0) total += scan(container);
+            }
+            checksum = total;
+        }, 3);
+        return checksum;
     };
     
-    std::vector<Node> nodes;
-    int head;
-    int free_list;
+    auto fill_sequence = [&](auto& container) {
+        for (size_t i = 0; i < initial; ++i) container.push_back(static_cast<int>(i));
+    };
     
-public:
-    ArrayBasedList() : head(-1), free_list(-1) {
-        nodes.reserve(1000);  // 预分配
-    }
+    long long vector_sum = run("std::vector",
+        [&]() { std::vector<int> v; v.reserve(initial + inserts); fill_sequence(v); return v; },
+        [](std::vector<int>& v, size_t pos, int value) { v.insert(v.begin() + pos, value); },
+        [](const std::vector<int>& v) { return std::accumulate(v.begin(), v.end(), 0LL); });
     
-    void push_front(int value) {
-        int new_index;
-        
-        if (free_list != -1) {
-            new_index = free_list;
-            free_list = nodes[free_list].next;
-        } else {
-            new_index = nodes.size();
-            nodes.emplace_back();
+    long long list_sum = run("std::list",
+        [&]() { std::list<int> l; fill_sequence(l); return l; },
+        [](std::list<int>& l, size_t pos, int value) { l.insert(std::next(l.begin(), pos), value); },
+        [](const std::list<int>& l) { return std::accumulate(l.begin(), l.end(), 0LL); });
+    
+    // ArrayBasedList只能头插，按逆序头插得到同样的初始序列
+    long long array_list_sum = run("ArrayBasedList",
+        [&]() {
+            ArrayBasedList l(initial + inserts);
+            for (size_t i = initial; i-- > 0;) l.push_front(static_cast<int>(i));
+            return l;
+        },
+        [](ArrayBasedList& l, size_t pos, int value) { l.insert(pos, value); },
+        [](const ArrayBasedList& l) { return l.sum(); });
+    
+    long long unrolled_sum = run("UnrolledList",
+        [&]() { UnrolledList<int> l; fill_sequence(l); return l; },
+        [](UnrolledList<int>& l, size_t pos, int value) { l.insert(l.at(pos), value); },
+        [](const UnrolledList<int>& l) {
+            long long total = 0;
+            l.forEachSegment([&](const int* items, size_t count) {
+                for (size_t i = 0; i < count; ++i) total += items[i];
+            });
+            return total;
+        });
+    
+    bool match = vector_sum == list_sum && vector_sum == array_list_sum && vector_sum == unrolled_sum;
+    std::cout << "Mixed workload results match: " << (match ? "Yes" : "No") << "\n";
+    
+    // 纯扫描：1M个元素
+    const size_t scan_size = 1000000;
+    std::vector<int> vec(scan_size);
+    std::iota(vec.begin(), vec.end(), 0);
+    std::list<int> lst(vec.begin(), vec.end());
+    UnrolledList<int> unrolled;
+    for (int value : vec) unrolled.push_back(value);
+    ArrayBasedList array_list(scan_size);
+    for (size_t i = scan_size; i-- > 0;) array_list.push_front(static_cast<int>(i));
+    
+    benchmarkFunction("Scan [std::vector]", [&]() {
+        volatile long long sum = std::accumulate(vec.begin(), vec.end(), 0LL);
+    }, 20);
+    benchmarkFunction("Scan [std::list]", [&]() {
+        volatile long long sum = std::accumulate(lst.begin(), lst.end(), 0LL);
+    }, 20);
+    benchmarkFunction("Scan [ArrayBasedList]", [&]() {
+        volatile long long sum = array_list.sum();
+    }, 20);
+    benchmarkFunction("Scan [UnrolledList iterator]", [&]() {
+        volatile long long sum = std::accumulate(unrolled.begin(), unrolled.end(), 0LL);
+    }, 20);
+    benchmarkFunction("Scan [UnrolledList segments]", [&]() {
+        long long total = 0;
+        unrolled.forEachSegment([&](const int* items, size_t count) {
+            for (size_t i = 0; i < count; ++i) total += items[i];
+        });
+        volatile long long sum = total;
+    }, 20);
+}
+
+// 用pmr容器重做上面的数据结构负载：同一份代码分别跑在默认分配器、
+// 标准库的unsynchronized_pool_resource、slab资源和arena资源上
+template<typename MakeResource>
+void runPmrWorkloads(const std::string& label, MakeResource&& make_resource) {
+    const int num_operations = 100000;
+    
+    benchmarkFunction("pmr forward_list [" + label + "]", [&]() {
+        auto resource = make_resource();
+        std::pmr::forward_list<int> list(resource.get());
+        for (int i = 0; i < num_operations; ++i) {
+            list.push_front(i);
         }
-        
-        nodes[new_index].data = value;
-        nodes[new_index].next = head;
-        head = new_index;
-    }
+        long long sum = 0;
+        for (int value : list) sum += value;
+        volatile long long result = sum;
+    }, 10);
     
-    void pop_front() {
-        if (head != -1) {
-            int old_head = head;
-            head = nodes[head].next;
-            nodes[old_head].next = free_list;
-            free_list = old_head;
+    benchmarkFunction("pmr vector growth [" + label + "]", [&]() {
+        auto resource = make_resource();
+        std::pmr::vector<std::pair<int, int>> nodes(resource.get());
+        for (int i = 0; i < num_operations; ++i) {
+            nodes.emplace_back(i, i - 1);
         }
-    }
+        volatile size_t result = nodes.size();
+    }, 10);
     
-    int sum() const {
-        int total = 0;
-        int current = head;
-        while (current != -1) {
-            total += nodes[current].data;
-            current = nodes[current].next;
+    benchmarkFunction("pmr unordered_map [" + label + "]", [&]() {
+        auto resource = make_resource();
+        std::pmr::unordered_map<int, int> map(resource.get());
+        for (int i = 0; i < num_operations; ++i) {
+            map[i * 7] = i;
         }
-        return total;
+        long long hits = 0;
+        for (int i = 0; i < num_operations; ++i) {
+            hits += map.count(i * 3);
+        }
+        volatile long long result = hits;
+    }, 10);
+    
+    benchmarkFunction("pmr strings [" + label + "]", [&]() {
+        auto resource = make_resource();
+        std::pmr::vector<std::pmr::string> strings(resource.get());
+        for (int i = 0; i < num_operations / 4; ++i) {
+            // 超出SSO长度，每个字符串都要真正分配
+            strings.emplace_back("request-scoped payload #" + std::to_string(i));
+        }
+        volatile size_t result = strings.back().size();
+    }, 10);
+}
+
+void testPmrContainers() {
+    std::cout << "\n=== PMR Container Test ===\n";
+    TRACE_SCOPE("testPmrContainers");
+    
+    // 默认资源走operator new，等价于std::allocator
+    runPmrWorkloads("new_delete", []() {
+        return std::unique_ptr<std::pmr::memory_resource, void (*)(std::pmr::memory_resource*)>(
+            std::pmr::new_delete_resource(), [](std::pmr::memory_resource*) {});
+    });
+    runPmrWorkloads("std pool", []() { return std::make_unique<std::pmr::unsynchronized_pool_resource>(); });
+    runPmrWorkloads("slab", []() { return std::make_unique<SlabMemoryResource<>>(); });
+    
+    // arena在整个基准期间存活，每次迭代结束release()，模拟请求级复用
+    SlabMemoryResource<> arena(SlabMemoryResource<>::Mode::Monotonic);
+    runPmrWorkloads("arena", [&]() {
+        arena.release();
+        return std::unique_ptr<std::pmr::memory_resource, void (*)(std::pmr::memory_resource*)>(
+            &arena, [](std::pmr::memory_resource*) {});
+    });
+}
+
+// 同一批排序算法在六种输入分布上的表现；数据在计时区域外生成（开启缓存时从磁盘读取），
+// 计时区域内除排序外只有一次数组复制
+void testSortDistributions() {
+    std::cout << "\n=== Sort vs Input Distribution ===\n";
+    TRACE_SCOPE("testSortDistributions");
+    
+    size_t n = benchmarkConfig().full_sizes ? (size_t(1) << 24) : (size_t(1) << 20);
+    std::cout << "Seed " << Workload::globalSeed() << ", cache "
+              << (Workload::cacheDir().empty() ? std::string("off") : Workload::cacheDir()) << "\n";
+    
+    bool ok = true;
+    for (Distribution distribution : {Distribution::Uniform, Distribution::Sorted, Distribution::ReverseSorted,
+                                      Distribution::FewUnique, Distribution::Zipfian, Distribution::OrganPipe}) {
+        WorkloadSpec spec{distribution, n, 0.0, 1e9, 100};
+        bool from_cache = false;
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<int> input = Workload::generate<int>(spec, &from_cache);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << Workload::name(distribution) << ": " << (from_cache ? "loaded" : "generated")
+                  << " in " << ms << " ms\n";
+        // 缓存里读出的数据抽查一遍，不整体重新生成，否则缓存就没有意义了
+        if (from_cache && !Workload::spotCheck(spec, input)) {
+            std::cout << "Cached workload MISMATCH: " << Workload::name(distribution) << "\n";
+            ok = false;
+        }
+        
+        std::vector<int> work(n);
+        std::string suffix = std::string(" [") + Workload::name(distribution) + "]";
+        benchmarkFunction("std::sort" + suffix, [&]() {
+            std::copy(input.begin(), input.end(), work.begin());
+            std::sort(work.begin(), work.end());
+        }, 5);
+        benchmarkFunction("std::stable_sort" + suffix, [&]() {
+            std::copy(input.begin(), input.end(), work.begin());
+            std::stable_sort(work.begin(), work.end());
+        }, 5);
+        ok = ok && std::is_sorted(work.begin(), work.end());
     }
-};
+    std::cout << "Sorted outputs verified: " << (ok ? "Yes" : "No") << "\n";
+}
 
 // 测试数据结构优化
 void testDataStructureOptimization() {
     std::cout << "\n=== Data Structure Optimization Test ===\n";
+    TRACE_SCOPE("testDataStructureOptimization");
     
     const int num_operations = 100000;
     
@@ -620,7 +6728,7 @@ void testDataStructureOptimization() {
         }
         
         // 求和操作
-        int sum = 0;
+        long long sum = 0;
         ListNode* current = head;
         while (current) {
             sum += current->data;
@@ -634,12 +6742,12 @@ void testDataStructureOptimization() {
             delete temp;
         }
         
-        volatile int result = sum;
+        volatile long long result = sum;
     }, 10);
     
     // 测试数组链表
     benchmarkFunction("Array-based List", [&]() {
-        ArrayBasedList list;
+        ArrayBasedList list(num_operations);
         
         // 插入操作
         for (int i = 0; i < num_operations; ++i) {
@@ -647,29 +6755,396 @@ void testDataStructureOptimization() {
         }
         
         // 求和操作
-        volatile int sum = list.sum();
+        volatile long long sum = list.sum();
     }, 10);
+    
+    testUnrolledList();
+    testIndexedList();
+    testPmrContainers();
+    testSortDistributions();
 }
 
+// =============================================================================
+// 6. 内存层次结构测量
+// =============================================================================
+
+// 测量本机的带宽、各级缓存延迟和TLB容量，前面矩阵、链表等结果可以对照着看：
+//   STREAM  - copy/scale/add/triad四个核，数组远大于末级缓存，测的是内存带宽
+//   延迟曲线 - 每条缓存行放一个指针，随机成环后逐跳追逐，每一跳都依赖上一次加载，
+//              预取器无能为力；工作集从4 KiB到1 GiB，拐点对应L1/L2/L3/内存
+//   TLB扫描 - 每页只访问随机一条缓存行（避免大页下物理地址连续造成的缓存组冲突），缓存占用很小而页数很多，
+//              延迟的台阶对应L1 dTLB和二级TLB的容量；4 KiB页和透明大页各跑一遍
+class MemoryHierarchy {
+public:
+    enum class Pages { Default, Small, Huge };
+    
+private:
+    // 匿名映射并按2 MiB对齐的缓冲区，可以要求/禁止透明大页；非Linux上退化为普通对齐分配
+    class PageBuffer {
+    private:
+        static constexpr size_t kHugePage = size_t(2) << 20;
+        void* mapping_ = nullptr;
+        size_t mapped_bytes_ = 0;
+        char* data_ = nullptr;
+        
+    public:
+        PageBuffer(size_t bytes, Pages pages) {
+#ifdef __linux__
+            mapped_bytes_ = bytes + kHugePage;
+            mapping_ = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping_ == MAP_FAILED) {
+                mapping_ = nullptr;
+                throw std::bad_alloc();
+            }
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(mapping_) + kHugePage - 1) & ~(kHugePage - 1);
+            data_ = reinterpret_cast<char*>(aligned);
+            if (pages == Pages::Huge) madvise(data_, bytes, MADV_HUGEPAGE);
+            if (pages == Pages::Small) madvise(data_, bytes, MADV_NOHUGEPAGE);
+#else
+            (void)pages;
+            mapping_ = std::aligned_alloc(kHugePage, (bytes + kHugePage - 1) / kHugePage * kHugePage);
+            if (!mapping_) throw std::bad_alloc();
+            data_ = static_cast<char*>(mapping_);
+#endif
+            // 先写一遍，把缺页开销挪到计时之外
+            std::memset(data_, 0, bytes);
+        }
+        
+        ~PageBuffer() {
+#ifdef __linux__
+            if (mapping_) munmap(mapping_, mapped_bytes_);
+#else
+            std::free(mapping_);
+#endif
+        }
+        
+        PageBuffer(const PageBuffer&) = delete;
+        PageBuffer& operator=(const PageBuffer&) = delete;
+        
+        char* data() const { return data_; }
+    };
+    
+    // 按随机顺序把offsets处的位置串成一个环，返回环上的起点
+    static const void* buildRing(char* base, std::vector<size_t>& offsets, Xoshiro256& rng) {
+        Workload::shuffle(offsets, rng);
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            *reinterpret_cast<void**>(base + offsets[i]) = base + offsets[(i + 1) % offsets.size()];
+        }
+        return base + offsets[0];
+    }
+    
+    static const void* chase(const void* start, size_t steps) {
+        const void* p = start;
+        for (size_t i = 0; i < steps; ++i) {
+            p = *static_cast<const void* const*>(p);
+        }
+        return p;
+    }
+    
+    // 在环上追逐steps跳，返回每跳的平均纳秒数；游标跨样本保留，环不会从头重新热身
+    static double measureChase(const std::string& name, const void* start, size_t steps) {
+        const void* cursor = start;
+        double ns = benchmarkFunction(name, [&]() {
+            cursor = chase(cursor, steps);
+        }, 5);
+        volatile const void* sink = cursor;
+        (void)sink;
+        return ns / steps;
+    }
+    
+    struct CurvePoint {
+        std::string label;
+        double value;
+    };
+    
+    // 打印“大小-数值”曲线；延迟跨越两个数量级，用对数刻度才能同时看清L1/L2和内存的台阶
+    static void printCurve(const std::string& title, const std::string& unit, const std::vector<CurvePoint>& points,
+                           bool log_scale = false) {
+        double min_value = std::numeric_limits<double>::max(), max_value = 0.0;
+        for (const auto& point : points) {
+            min_value = std::min(min_value, point.value);
+            max_value = std::max(max_value, point.value);
+        }
+        std::cout << "\n" << title << (log_scale ? " (log scale)" : "") << "\n";
+        for (const auto& point : points) {
+            double fraction = 0.0;
+            if (log_scale && max_value > min_value && min_value > 0.0) {
+                fraction = std::log(point.value / min_value) / std::log(max_value / min_value);
+            } else if (!log_scale && max_value > 0.0) {
+                fraction = point.value / max_value;
+            }
+            int bar = static_cast<int>(fraction * 49.0 + 1.5);
+            std::cout << "  " << std::setw(12) << point.label << " " << std::setw(9) << std::fixed
+                      << std::setprecision(2) << point.value << " " << unit << "  "
+                      << std::string(std::max(bar, 1), '#') << "\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+#ifdef __linux__
+    // sysconf来自<unistd.h>，只在Linux分支里包含
+    static size_t cacheSize(int name) {
+        long bytes = sysconf(name);
+        return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+    }
+#endif
+    
+public:
+    static void printReportedCaches() {
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && \
+    defined(_SC_LEVEL3_CACHE_SIZE)
+        std::cout << "Reported caches: L1d " << formatBytes(cacheSize(_SC_LEVEL1_DCACHE_SIZE))
+                  << ", L2 " << formatBytes(cacheSize(_SC_LEVEL2_CACHE_SIZE))
+                  << ", L3 " << formatBytes(cacheSize(_SC_LEVEL3_CACHE_SIZE)) << "\n";
+#else
+        std::cout << "Reported caches: unavailable on this platform\n";
+#endif
+    }
+    
+    // STREAM：每个数组取末级缓存的4倍，限制在64 MiB到256 MiB（--full时1 GiB）之间，
+    // 读不到末级缓存大小时用64 MiB；多于一个线程时再用全部线程跑一遍
+    static void testStream() {
+        std::cout << "\n=== STREAM Bandwidth ===\n";
+        TRACE_SCOPE("MemoryHierarchy::testStream");
+        
+        size_t array_bytes = size_t(64) << 20;
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+        const size_t max_bytes = benchmarkConfig().full_sizes ? (size_t(1) << 30) : (size_t(256) << 20);
+        array_bytes = std::min(std::max(array_bytes, 4 * cacheSize(_SC_LEVEL3_CACHE_SIZE)), max_bytes);
+#endif
+        const size_t n = array_bytes / sizeof(double);
+        std::vector<double, AlignedAllocator<double>> a(n, 1.0), b(n, 2.0), c(n, 0.0);
+        const double scalar = 3.0;
+        
+        struct Kernel {
+            const char* name;
+            size_t arrays;  // 每个元素读写的数组个数（STREAM的字节计数约定）
+            std::function<void(size_t, size_t)> body;
+        };
+        std::vector<Kernel> kernels = {
+            {"Copy", 2, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) c[i] = a[i];
+            }},
+            {"Scale", 2, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) b[i] = scalar * c[i];
+            }},
+            {"Add", 3, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) c[i] = a[i] + b[i];
+            }},
+            {"Triad", 3, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) a[i] = b[i] + scalar * c[i];
+            }},
+        };
+        
+        std::vector<size_t> thread_counts = {1};
+        size_t hardware_threads = WorkStealingPool::instance().size();
+        if (hardware_threads > 1) thread_counts.push_back(hardware_threads);
+        
+        std::cout << "Array size: " << formatBytes(array_bytes) << " x 3\n";
+        for (size_t threads : thread_counts) {
+            std::vector<CurvePoint> points;
+            for (const Kernel& kernel : kernels) {
+                std::string name = std::string("STREAM ") + kernel.name + " threads=" + std::to_string(threads);
+                double ns = benchmarkFunction(name, [&]() {
+                    if (threads == 1) {
+                        kernel.body(0, n);
+                        return;
+                    }
+                    // 按线程数的4倍分块，块边界按8个double（一条缓存行）对齐
+                    size_t chunks = threads * 4;
+                    size_t chunk = (n / chunks + 7) / 8 * 8;
+                    WorkStealingPool::instance().parallelFor(chunks, [&](size_t t) {
+                        size_t begin = std::min(n, t * chunk);
+                        size_t end = t + 1 == chunks ? n : std::min(n, begin + chunk);
+                        kernel.body(begin, end);
+                    }, threads);
+                }, 10);
+                points.push_back({kernel.name, kernel.arrays * array_bytes / ns});
+            }
+            printCurve("STREAM bandwidth, threads=" + std::to_string(threads), "GB/s", points);
+        }
+    }
+    
+    // 延迟曲线：4 KiB到256 MiB，--full时到1 GiB
+    static void testLatencyCurve() {
+        std::cout << "\n=== Memory Latency Curve ===\n";
+        TRACE_SCOPE("MemoryHierarchy::testLatencyCurve");
+        printReportedCaches();
+        
+        const size_t max_bytes = benchmarkConfig().full_sizes ? (size_t(1) << 30) : (size_t(256) << 20);
+        const size_t steps = size_t(1) << 18;
+        Xoshiro256 rng = Workload::rng(42);
+        std::vector<CurvePoint> points;
+        for (size_t bytes = size_t(4) << 10; bytes <= max_bytes; bytes *= 2) {
+            PageBuffer buffer(bytes, Pages::Default);
+            std::vector<size_t> offsets(bytes / 64);
+            for (size_t i = 0; i < offsets.size(); ++i) offsets[i] = i * 64;
+            const void* start = buildRing(buffer.data(), offsets, rng);
+            double ns = measureChase("Pointer chase " + formatBytes(bytes), start, steps);
+            points.push_back({formatBytes(bytes), ns});
+        }
+        printCurve("Load-to-use latency vs working set", "ns", points, true);
+    }
+    
+    // TLB扫描：16到16K页（--full时到256K页），每页一条缓存行
+    static void testTlbSweep() {
+        std::cout << "\n=== TLB Sweep ===\n";
+        TRACE_SCOPE("MemoryHierarchy::testTlbSweep");
+        
+        const size_t page = 4096;
+        const size_t max_pages = benchmarkConfig().full_sizes ? (size_t(256) << 10) : (size_t(16) << 10);
+        const size_t steps = size_t(1) << 18;
+        Xoshiro256 rng = Workload::rng(7);
+        for (Pages pages : {Pages::Small, Pages::Huge}) {
+            const char* label = pages == Pages::Small ? "4 KiB pages" : "THP";
+            std::vector<CurvePoint> points;
+            for (size_t count = 16; count <= max_pages; count *= 2) {
+                PageBuffer buffer(count * page, pages);
+                std::vector<size_t> offsets(count);
+                for (size_t i = 0; i < count; ++i) offsets[i] = i * page + rng.below(page / 64) * 64;
+                const void* start = buildRing(buffer.data(), offsets, rng);
+                std::string pages_label = std::to_string(count) + " pages";
+                double ns = measureChase(std::string("TLB sweep [") + label + "] " + pages_label, start, steps);
+                points.push_back({pages_label, ns});
+            }
+            printCurve(std::string("Latency vs pages touched (") + label + ")", "ns", points, true);
+        }
+    }
+    
+    static void testMemoryHierarchy() {
+        testStream();
+        testLatencyCurve();
+        testTlbSweep();
+    }
+};
+
 // =============================================================================
 // 主测试函数
 // =============================================================================
 
-int main() {
+// 命令行选项
+struct BenchmarkOptions {
+    std::string json_path;      // --json=FILE    导出JSON结果
+    std::string csv_path;       // --csv=FILE     导出CSV结果
+    std::string baseline_path;  // --baseline=FILE 与保存的基线对比
+    double threshold = 0.05;    // --threshold=PCT 判定退化的相对阈值
+    std::string trace_path;     // --trace=FILE   导出Chrome trace_event JSON
+    bool retune = false;        // --retune        忽略已保存的分块调优结果
+                                // --tuning-file=FILE 分块调优结果文件（默认$XDG_CACHE_HOME/cpp-study-plan/matmul_tuning.cfg）
+                                // --perf          读取硬件性能计数器
+                                // --full          加入耗时较长的大尺寸用例
+                                // --telemetry=FILE 导出分配遥测快照（JSON）
+                                // --isa=LEVEL     强制SIMD指令集：scalar/sse2/avx2/avx512
+                                // --seed=N        测试数据的全局种子（默认42）
+                                // --workload-cache=DIR 把生成较慢的测试数据缓存到DIR
+};
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& prefix) { return arg.substr(prefix.size()); };
+        if (arg.rfind("--json=", 0) == 0) {
+            options.json_path = value("--json=");
+        } else if (arg.rfind("--csv=", 0) == 0) {
+            options.csv_path = value("--csv=");
+        } else if (arg.rfind("--baseline=", 0) == 0) {
+            options.baseline_path = value("--baseline=");
+        } else if (arg.rfind("--threshold=", 0) == 0) {
+            options.threshold = std::stod(value("--threshold=")) / 100.0;
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            options.trace_path = value("--trace=");
+            TraceProfiler::instance().enable();
+        } else if (arg == "--perf") {
+            benchmarkConfig().hardware_counters = true;
+        } else if (arg == "--retune") {
+            options.retune = true;
+        } else if (arg.rfind("--tuning-file=", 0) == 0) {
+            BlockSizeTuner::instance().setPath(value("--tuning-file="));
+        } else if (arg == "--full") {
+            benchmarkConfig().full_sizes = true;
+        } else if (arg.rfind("--telemetry=", 0) == 0) {
+            benchmarkConfig().telemetry_path = value("--telemetry=");
+        } else if (arg.rfind("--isa=", 0) == 0) {
+            SimdLevel level = CpuFeatures::parse(value("--isa="));
+            CpuFeatures::instance().force(level);
+            SIMDOptimization::selectKernels(level);
+            SIMDReductions::selectKernels(level);
+            BranchOptimization::selectKernels(level);
+            BulkPopcount::selectKernels(level);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            Workload::setSeed(std::stoull(value("--seed=")));
+        } else if (arg.rfind("--workload-cache=", 0) == 0) {
+            Workload::setCacheDir(value("--workload-cache="));
+        } else if (arg.rfind("--budget-ms=", 0) == 0) {
+            benchmarkConfig().target_time_ms = std::stod(value("--budget-ms="));
+        } else {
+            throw std::invalid_argument("unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "=== C++ Performance Optimization Benchmarks ===\n";
     std::cout << "Compiled with optimization flags for best performance\n";
     
     try {
+        BenchmarkOptions options = parseBenchmarkOptions(argc, argv);
+        if (benchmarkConfig().hardware_counters && !HardwareCounters::instance().available()) {
+            std::cout << "Hardware counters unavailable (" << HardwareCounters::instance().error()
+                      << "), falling back to timing only\n";
+        }
+        
+        // 重新调优时直接跳过加载，testCacheOptimization会调优并覆盖文件
+        if (!options.retune) {
+            BlockSizeTuner::instance().load();
+        }
+        
+        // 先加载基线，文件有问题时不必等全部基准跑完才报错
+        std::vector<BenchmarkStats> baseline;
+        if (!options.baseline_path.empty()) {
+            baseline = BenchmarkReport::loadBaseline(options.baseline_path);
+        }
+        
         // 测试各种优化技术
-        CacheOptimization::testCacheOptimization();
-        testMemoryPool();
-        SIMDOptimization::testSIMDOptimization();
-        BranchOptimization::testBranchOptimization();
-        testDataStructureOptimization();
+        {
+            BENCHMARK("All benchmarks");
+            // 先测量本机的内存层次，后面的结果可以对照着读
+            MemoryHierarchy::testMemoryHierarchy();
+            CacheOptimization::testCacheOptimization();
+            CacheOptimization::testCacheOblivious();
+            CacheOptimization::testParallelScaling();
+            testMemoryPool();
+            SIMDOptimization::testSIMDOptimization();
+            SIMDReductions::testReductions();
+            FusedArrayOps::testExpressionTemplates();
+            BranchOptimization::testBranchOptimization();
+            BulkPopcount::testBulkPopcount();
+            testDataStructureOptimization();
+        }
         
         std::cout << "\n=== All performance tests completed! ===\n";
         std::cout << "Note: Results may vary depending on hardware and compiler optimizations.\n";
         
+        if (!options.trace_path.empty()) {
+            TraceProfiler::instance().dump(options.trace_path);
+        }
+        
+        const auto& results = BenchmarkRegistry::instance().getResults();
+        if (!options.json_path.empty()) {
+            BenchmarkReport::save(results, options.json_path);
+        }
+        if (!options.csv_path.empty()) {
+            BenchmarkReport::save(results, options.csv_path);
+        }
+        if (!options.baseline_path.empty()) {
+            if (BenchmarkReport::compare(baseline, results, options.threshold) > 0) {
+                return 2;  // 供CI判定性能退化
+            }
+        }
+        
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -682,22 +7157,42 @@ int main() {
 编译和运行说明：
 
 1. 编译命令（重要！）：
-   g++ -std=c++17 -O2 -march=native -pthread -mavx2 -o practice_exercises practice_exercises.cpp
+   g++ -std=c++17 -O2 -pthread -o practice_exercises practice_exercises.cpp
    
    参数说明：
    -O2: 开启优化
-   -march=native: 针对本机CPU优化
-   -mavx2: 启用AVX2指令集
    -pthread: 线程支持
+   
+   SIMD内核（SSE2/AVX2/AVX-512）通过target属性单独编译，启动时按CPU选择，
+   所以不需要-mavx2，生成的程序在任何x86-64机器上都能运行。
+   只在本机运行时可以加-march=native，让其余代码也针对本机CPU优化
+   （这样编出的程序不能拿到更老的机器上运行）。
 
 2. 运行：
    ./practice_exercises
+   ./practice_exercises --json=baseline.json           # 保存结果（.csv后缀则输出CSV）
+   ./practice_exercises --baseline=baseline.json       # 与基线对比，存在显著退化时返回2
+   ./practice_exercises --baseline=baseline.json --threshold=10 --budget-ms=500
+   ./practice_exercises --perf                         # 附带每次调用的cycles/指令/缓存缺失/分支预测失败
+   ./practice_exercises --trace=trace.json             # 导出嵌套作用域，用chrome://tracing或Perfetto打开
+   ./practice_exercises --full                         # 包含n=4096矩阵乘法等大尺寸用例
+   ./practice_exercises --retune                       # 重新调优分块形状并写入~/.cache/cpp-study-plan/matmul_tuning.cfg
+   ./practice_exercises --tuning-file=tuning.cfg       # 调优结果改存到指定文件
+   ./practice_exercises --telemetry=alloc.json         # 导出各内存池的分配遥测快照
+   ./practice_exercises --isa=sse2                     # 强制使用较低的SIMD指令集（scalar/sse2/avx2/avx512）
+   ./practice_exercises --seed=7                       # 换一组测试数据；同一种子的运行之间结果可直接对比
+   ./practice_exercises --workload-cache=workloads     # 排序/Zipf等生成较慢的数据集缓存到目录，下次直接读取
 
 3. 预期输出：
    - 各种优化技术的性能对比
    - 缓存友好 vs 缓存不友好的性能差异
    - SIMD vs 标量计算的性能提升
+   - 各种归约累加方式的吞吐量与误差（相对long double参考值）
+   - 表达式模板融合逐元素运算后节省的内存带宽
    - 分支预测优化的效果
+   - 本机的STREAM带宽、访存延迟随工作集大小的曲线和TLB容量的台阶
+   - 批量popcount各内核（查表/SWAR/POPCNT/Mula/Harley-Seal）在1 KiB到1 GiB上的吞吐量
+   - 排序在均匀/有序/逆序/少量重复值/Zipf/管风琴六种输入分布上的耗时差异
 
 4. 学习重点：
    - 缓存友好的数据访问模式
@@ -707,6 +7202,8 @@ int main() {
    - 数据结构选择对性能的影响
 
 5. 性能分析工具：
+   - 使用--perf直接读取每个基准的缓存缺失和分支预测失败次数
+     （需要/proc/sys/kernel/perf_event_paranoid <= 2，否则自动退化为只计时）
    - 使用perf工具分析缓存命中率
    - 使用valgrind分析内存使用
    - 使用gprof分析函数调用开销